@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../shaderLib/ShaderCPU.hpp"
+#include "../shaderLib/ShaderCost.hpp"
+#include "../shaderLib/ShaderLibMaster.hpp"
+#include "../shaderLib/ShaderOptimize.hpp"
+
+// === Static layer baking === //
+// Plenty of elements never read u_time or an audio uniform - no behavior, and
+// a structure that doesn't animate (waveGrid, star, voronoi, ... unlike blob)
+// - yet the shader recomputes them for every pixel of every frame.
+//   1. traceUniforms(): forward dataflow over the optimised Program. Every
+//      variable carries the set of uniforms its value depends on, through
+//      expressions, helper bodies (u_time inside julia()) and the shared uv /
+//      col. An element whose val_i and layerCol_i depend on none is static.
+//   2. bakeStaticLayers(): renders layerCol_i / val_i of the static elements
+//      once on the CPU (ShaderCPU.hpp) into an RGBA float texture over vPos.xy,
+//      and rewrites the program to read them back with a texture fetch. The
+//      optimiser then drops the structure / texture / colour chain that fed
+//      them. The layering itself stays in the shader: it reads col, which
+//      earlier dynamic layers change every frame.
+// Per-frame cost is then the dynamic layers plus one fetch per baked one
+// (estimateTemplateCost vs estimateCost on the baked program).
+//
+// The texture covers vPos.xy in [-extent, extent]^2. On the ShadedSphere both
+// hemispheres land on the same xy, so the default extent is its radius.
+// Texel size bounds the detail: 1024^2 over the sphere is ~0.03 units a texel.
+
+namespace shaderLib {
+
+struct UniformDependencies {
+  std::vector<std::string> uniforms; ///< every uniform the program reads; bit u = uniforms[u]
+  std::vector<uint64_t> elements;    ///< per element: uniforms val_i / layerCol_i depend on
+
+  bool isStatic(int element) const {
+    return element >= 0 && element < static_cast<int>(elements.size()) && elements[element] == 0;
+  }
+  bool dependsOn(int element, std::string_view uniform) const {
+    if (element < 0 || element >= static_cast<int>(elements.size())) return false;
+    for (size_t u = 0; u < uniforms.size(); ++u) {
+      if (uniforms[u] == uniform) return (elements[element] >> std::min<size_t>(u, 63)) & 1;
+    }
+    return false;
+  }
+};
+
+namespace detail {
+
+inline bool isIdentChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// name appears in text as a whole identifier
+inline bool mentions(std::string_view text, std::string_view name) {
+  for (size_t at = text.find(name); at != std::string_view::npos; at = text.find(name, at + 1)) {
+    const size_t end = at + name.size();
+    if ((at == 0 || !isIdentChar(text[at - 1])) && (end == text.size() || !isIdentChar(text[end])))
+      return true;
+  }
+  return false;
+}
+
+// a float some helper preamble #defines (JULIA_OUTSIDE) - only changes with QUALITY
+inline bool isHelperDefine(const shaderIR::Program &p, std::string_view name) {
+  for (const shaderIR::HelperDef *h : p.helpers) {
+    const std::string_view pre = h->preamble;
+    for (size_t at = pre.find("#define "); at != std::string_view::npos; at = pre.find("#define ", at + 1)) {
+      const size_t begin = at + 8, end = begin + name.size();
+      if (pre.substr(begin, name.size()) == name && (end == pre.size() || !isIdentChar(pre[end])))
+        return true;
+    }
+  }
+  return false;
+}
+
+// forward dataflow over the statements with one T per variable slot: what the
+// variable's current value depends on. Derived supplies eval(ExprId), reading
+// variables through at(), and static join(T, T) for partial / guarded writes.
+// traceElements() returns what each element's layer (val_i + layerCol_i) ends
+// up depending on. UniformTracer (here) and RateTracer (ShaderMultiRate.hpp)
+template <typename Derived, typename T>
+class VarTracer {
+protected:
+  explicit VarTracer(const shaderIR::Program &p) : mP(p) {}
+
+  std::vector<T> traceElements() {
+    using shaderIR::StmtOp;
+    Derived &self = static_cast<Derived &>(*this);
+    int maxElement = -1;
+    for (const auto &s : mP.stmts) maxElement = std::max<int>(maxElement, s.element);
+    mSlots.assign(shaderIR::varSlotCount(maxElement), T{});
+
+    for (const shaderIR::Stmt &s : mP.stmts) {
+      if (s.op == StmtOp::Comment) continue;
+      T v = self.eval(s.value);
+      if (s.guarded()) v = Derived::join(v, self.eval(s.guard));
+      const bool fullWrite =
+          (s.op == StmtOp::Declare || s.op == StmtOp::Assign) && s.target.component < 0 && !s.guarded();
+      T &dst = mSlots[shaderIR::varSlot(s.target)];
+      dst = fullWrite ? v : Derived::join(dst, v);
+    }
+    std::vector<T> elements(maxElement + 1, T{});
+    for (int i = 0; i <= maxElement; ++i) {
+      elements[i] = Derived::join(at(shaderIR::Var::val(i)), at(shaderIR::Var::layerCol(i)));
+    }
+    return elements;
+  }
+
+  T at(const shaderIR::Var &v) const { return mSlots[shaderIR::varSlot(v)]; }
+
+  const shaderIR::Program &mP;
+  std::vector<T> mSlots;
+};
+
+class UniformTracer : public VarTracer<UniformTracer, uint64_t> {
+public:
+  UniformTracer(const shaderIR::Program &p, const std::vector<std::string> &known) : VarTracer(p) {
+    for (const std::string &u : known) bit(u);
+    for (const shaderIR::HelperDef *h : p.helpers) {
+      uint64_t mask = 0;
+      for (size_t u = 0; u < mDeps.uniforms.size(); ++u) {
+        if (mentions(h->preamble, mDeps.uniforms[u]) || mentions(h->body, mDeps.uniforms[u]))
+          mask |= 1ull << std::min<size_t>(u, 63);
+      }
+      mHelpers.push_back({h, mask});
+    }
+  }
+
+  UniformDependencies run() {
+    mDeps.elements = traceElements();
+    return std::move(mDeps);
+  }
+
+private:
+  friend class VarTracer<UniformTracer, uint64_t>;
+  static uint64_t join(uint64_t a, uint64_t b) { return a | b; }
+
+  // bit for a uniform name; more than 64 distinct uniforms share the last bit
+  uint64_t bit(std::string_view name) {
+    size_t u = 0;
+    while (u < mDeps.uniforms.size() && mDeps.uniforms[u] != name) ++u;
+    if (u == mDeps.uniforms.size()) mDeps.uniforms.emplace_back(name);
+    return 1ull << std::min<size_t>(u, 63);
+  }
+
+  uint64_t eval(shaderIR::ExprId id) {
+    using shaderIR::Op;
+    const shaderIR::Expr &e = mP.exprs[id];
+    uint64_t m = 0;
+    switch (e.op) {
+    case Op::Var: return at(e.var);
+    case Op::Uniform: {
+      const std::string_view name = mP.text(e.symbol);
+      return isHelperDefine(mP, name) ? 0 : bit(name);
+    }
+    case Op::Call:
+      if (e.fn == shaderIR::Fn::Helper) {
+        for (const auto &h : mHelpers) {
+          if (h.def == e.helper) m |= h.mask;
+        }
+      }
+      break;
+    default: break;
+    }
+    for (int i = 0; i < e.argc; ++i) m |= eval(e.args[i]);
+    return m;
+  }
+
+  struct HelperReads {
+    const shaderIR::HelperDef *def;
+    uint64_t mask;
+  };
+
+  UniformDependencies mDeps;
+  std::vector<HelperReads> mHelpers;
+};
+
+} // namespace detail
+
+// which uniforms each element's layer depends on. known: uniforms to look for
+// inside helper bodies (the template's globalUniforms; u_time is always added)
+inline UniformDependencies traceUniforms(const shaderIR::Program &p, std::vector<std::string> known) {
+  if (std::find(known.begin(), known.end(), "u_time") == known.end()) known.insert(known.begin(), "u_time");
+  return detail::UniformTracer(p, known).run();
+}
+
+struct BakeOptions {
+  int size = 1024;       ///< texture is size x size
+  float extent = 15.0f;  ///< covers vPos.xy in [-extent, extent]^2 (ShadedSphere radius)
+  int quality = 2;       ///< QUALITY tier, baked and printed
+  double minUnits = 8.0; ///< leave elements cheaper than this (ShaderCost.hpp units) live
+  unsigned threads = 0;  ///< CPU bake threads, 0 -> hardware_concurrency
+};
+
+// one baked element: bind rgba as a float RGBA texture (linear filtering,
+// clamp to edge) to the sampler uniform (ShadedMesh::setTexture)
+struct BakedLayer {
+  int element = -1;
+  std::string sampler;     ///< "u_bake<element>"
+  int size = 0;
+  std::vector<float> rgba; ///< size x size texels, rows bottom to top: layerCol_i.rgb, val_i
+};
+
+struct BakedShader {
+  std::string glsl; ///< fragment source, reads the baked layers
+  std::vector<BakedLayer> layers;
+  UniformDependencies dependencies;
+  CostEstimate before; ///< per-frame estimate without baking
+  CostEstimate after;  ///< and with
+};
+
+namespace detail {
+
+// element i's layer comes from the texture: right after its last write of
+// val_i / layerCol_i, one fetch into bake_i overwrites both (.rgb / .a).
+// whatever computed them before is dead from there on and the optimiser
+// removes it
+inline void sampleBakedLayer(shaderIR::Program &ir, int element, const std::string &sampler,
+                             float extent) {
+  using shaderIR::Var;
+  const Var val = Var::val(element), layerCol = Var::layerCol(element);
+  size_t at = 0;
+  bool hasVal = false, hasCol = false;
+  for (size_t i = 0; i < ir.stmts.size(); ++i) {
+    const shaderIR::Stmt &s = ir.stmts[i];
+    if (s.op == shaderIR::StmtOp::Comment) continue;
+    const bool v = shaderIR::sameStorage(s.target, val), c = shaderIR::sameStorage(s.target, layerCol);
+    hasVal |= v;
+    hasCol |= c;
+    if (v || c) at = i + 1;
+  }
+  // texture(u_bake_i, vPos.xy * (0.5 / extent) + 0.5)
+  const shaderIR::ExprId coord = ir.add(
+      ir.mul(ir.symbol("vPos.xy", shaderIR::Type::Vec2), ir.constant(0.5 / extent)), ir.constant(0.5));
+  const int saved = ir.currentElement();
+  ir.beginElement(element);
+  std::vector<shaderIR::Stmt> fetch;
+  const size_t first = ir.stmts.size();
+  ir.declare(Var::baked(element), ir.sample(sampler, coord, shaderIR::Type::Vec4));
+  if (hasCol) ir.assign(layerCol, ir.var(Var::baked(element, Var::kRGB)));
+  if (hasVal) ir.assign(val, ir.var(Var::baked(element, Var::kAlpha)));
+  fetch.assign(ir.stmts.begin() + static_cast<std::ptrdiff_t>(first), ir.stmts.end());
+  ir.stmts.resize(first);
+  ir.stmts.insert(ir.stmts.begin() + static_cast<std::ptrdiff_t>(at), fetch.begin(), fetch.end());
+  ir.beginElement(saved);
+}
+
+// the element still writes its layer (val_i / layerCol_i); one whose layering
+// folded away has nothing to bake or render separately
+inline bool writesLayer(const shaderIR::Program &ir, int element) {
+  for (const shaderIR::Stmt &s : ir.stmts) {
+    if (s.op != shaderIR::StmtOp::Comment && s.element == element &&
+        (s.target.kind == shaderIR::VarKind::Val || s.target.kind == shaderIR::VarKind::LayerCol))
+      return true;
+  }
+  return false;
+}
+
+// every helper the element calls can run on the CPU
+inline bool hasCPUPorts(const shaderIR::Program &ir, int element) {
+  bool ok = true;
+  auto check = [&](auto &&self, shaderIR::ExprId id) -> void {
+    const shaderIR::Expr &e = ir.exprs[id];
+    if (e.op == shaderIR::Op::Call && e.fn == shaderIR::Fn::Helper &&
+        !shaderCPU::helperTable().count(e.helper->name))
+      ok = false;
+    for (int i = 0; i < e.argc; ++i) self(self, e.args[i]);
+  };
+  for (const shaderIR::Stmt &s : ir.stmts) {
+    if (s.element != element || s.op == shaderIR::StmtOp::Comment) continue;
+    check(check, s.value);
+    if (s.guarded()) check(check, s.guard);
+  }
+  return ok;
+}
+
+} // namespace detail
+
+// GLSL for tmpl with its static layers baked into textures. with nothing worth
+// baking, glsl is what generateShaderCode prints and layers is empty
+inline BakedShader bakeStaticLayers(const ShaderTemplate &tmpl, const BakeOptions &options = {}) {
+  BakedShader out;
+  const int elementCount = static_cast<int>(tmpl.elements.size());
+  shaderIR::Program ir;
+  buildTemplate(ir, tmpl);
+  shaderIR::optimize(ir);
+  out.dependencies = traceUniforms(ir, tmpl.globalUniforms);
+  out.before = estimateCost(ir, elementCount, {}, options.quality);
+
+  std::vector<shaderIR::Var> vars;
+  for (int i = 0; i < static_cast<int>(out.dependencies.elements.size()); ++i) {
+    if (!out.dependencies.isStatic(i) || i >= elementCount) continue;
+    if (out.before.elementUnits[i] < options.minUnits) continue;
+    if (!detail::hasCPUPorts(ir, i) || !detail::writesLayer(ir, i)) continue;
+    BakedLayer layer;
+    layer.element = i;
+    layer.sampler = "u_bake" + std::to_string(i);
+    layer.size = std::max(1, options.size);
+    out.layers.push_back(std::move(layer));
+    vars.push_back(shaderIR::Var::layerCol(i));
+    vars.push_back(shaderIR::Var::val(i));
+  }
+
+  std::vector<std::string> samplers;
+  if (!out.layers.empty()) {
+    // one CPU pass for every layer, split into a texture each. the time is
+    // irrelevant - nothing baked reads it
+    shaderCPU::RenderOptions ro;
+    ro.threads = options.threads;
+    ro.quality = options.quality;
+    ro.useSymmetry = false;
+    shaderCPU::Renderer renderer(tmpl, ro);
+    std::vector<float> texels;
+    const int size = out.layers.front().size;
+    renderer.sampleVars(0.0f, size, options.extent, vars, texels);
+    const size_t stride = out.layers.size() * 4, count = size_t(size) * size_t(size);
+    for (size_t l = 0; l < out.layers.size(); ++l) {
+      BakedLayer &layer = out.layers[l];
+      layer.rgba.resize(count * 4);
+      for (size_t t = 0; t < count; ++t) std::copy_n(&texels[t * stride + l * 4], 4, &layer.rgba[t * 4]);
+    }
+
+    for (auto it = out.layers.rbegin(); it != out.layers.rend(); ++it) {
+      detail::sampleBakedLayer(ir, it->element, it->sampler, options.extent);
+    }
+    shaderIR::optimize(ir);
+    for (const BakedLayer &layer : out.layers) samplers.push_back(layer.sampler);
+  }
+  out.after = estimateCost(ir, elementCount, {}, options.quality);
+  out.glsl = printShaderCode(tmpl, ir, options.quality, samplers);
+  return out;
+}
+
+} // namespace shaderLib
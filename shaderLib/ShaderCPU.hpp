@@ -0,0 +1,1129 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+// === CPU reference backend === //
+// Renders a ShaderTemplate without a GL context (CI, offline previews). It runs
+// the same optimised shaderIR::Program the GLSL backend prints - placement,
+// size, behaviors, structure, texture, colour, layering, background - over
+// batches of kLanes pixels:
+//   - every IR value is kLanes floats per component, and every op is a plain
+//     loop over the lanes, so the compiler turns them into SIMD
+//   - sin/cos/atan/pow/floor are branch-free approximations (math:: below)
+//     so loops calling them vectorise too; they're within ~1e-5 of libm,
+//     about as close as GPU drivers agree with each other
+//   - structure helpers are C++ ports of the GLSL in structures.hpp, written
+//     lanes-innermost (loops over iterations/octaves outside)
+//   - image rows are handed out to a pool of threads
+//   - when the template folds uv before anything reads it (symmetry emitter),
+//     only the unique half/quadrant is evaluated and the rest mirrored
+//   - footprint-guarded structures (structures.hpp) are skipped for a whole
+//     batch when none of its lanes falls inside the footprint
+// Build with -O3 (and ideally -fno-math-errno so sqrt vectorises).
+//
+// A new structure / helper needs a matching entry in helperTable() below, or
+// it renders as 0 with a warning.
+
+namespace shaderCPU {
+
+using shaderUtility::ShaderTemplate;
+
+// pixels per batch. wide enough that walking the IR once per batch is noise
+// next to the lane loops
+constexpr int kLanes = 64;
+
+// ---- branch-free scalar math, vectorisable inside lane loops ---- //
+namespace math {
+
+constexpr float kPi = 3.14159265358979f;
+constexpr float kHalfPi = 1.57079632679490f;
+constexpr float kTwoPi = 6.28318530717959f;
+
+inline float floor(float x) {
+  const float t = static_cast<float>(static_cast<int32_t>(x));
+  return t - (t > x ? 1.0f : 0.0f);
+}
+inline float fract(float x) { return x - floor(x); }
+// GLSL mod: x - y * floor(x / y)
+inline float mod(float x, float y) { return x - y * floor(x / y); }
+inline float clamp(float x, float lo, float hi) { return std::min(std::max(x, lo), hi); }
+inline float mix(float a, float b, float t) { return a + (b - a) * t; }
+inline float step(float edge, float x) { return x < edge ? 0.0f : 1.0f; }
+inline float smoothstep(float e0, float e1, float x) {
+  const float t = clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+inline float sin(float x) {
+  // reduce to [-pi, pi], fold to [-pi/2, pi/2], odd Taylor to x^11
+  float r = x - kTwoPi * floor(x * (1.0f / kTwoPi) + 0.5f);
+  r = r > kHalfPi ? kPi - r : r;
+  r = r < -kHalfPi ? -kPi - r : r;
+  const float r2 = r * r;
+  return r * (1.0f + r2 * (-1.6666667e-1f +
+                     r2 * (8.3333333e-3f +
+                     r2 * (-1.9841270e-4f +
+                     r2 * (2.7557319e-6f + r2 * -2.5052108e-8f)))));
+}
+inline float cos(float x) { return sin(x + kHalfPi); }
+
+inline float atan2(float y, float x) {
+  const float ax = std::fabs(x), ay = std::fabs(y);
+  const float mx = std::max(ax, ay), mn = std::min(ax, ay);
+  const float a = mn / std::max(mx, 1e-30f);
+  const float s = a * a;
+  float r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f +
+              s * (0.05265332f - s * 0.01172120f)))));
+  r = ay > ax ? kHalfPi - r : r;
+  r = x < 0.0f ? kPi - r : r;
+  return y < 0.0f ? -r : r;
+}
+
+inline float log2(float x) { // x > 0, normal; sign ignored
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  float e = static_cast<float>(static_cast<int32_t>((bits >> 23) & 255u) - 127);
+  bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+  float m;
+  std::memcpy(&m, &bits, sizeof(m)); // [1, 2)
+  const bool big = m > 1.41421356f;
+  m = big ? m * 0.5f : m;
+  e = big ? e + 1.0f : e;
+  const float t = (m - 1.0f) / (m + 1.0f);
+  const float t2 = t * t;
+  const float ln = 2.0f * t * (1.0f + t2 * (1.0f / 3.0f + t2 * (1.0f / 5.0f + t2 * (1.0f / 7.0f))));
+  return e + ln * 1.44269504f;
+}
+
+inline float exp2(float x) {
+  // clamp with selects, round with the 1.5 * 2^23 trick: a clamped value fed to
+  // a float -> int cast makes gcc branch and the lane loop stops vectorising
+  x = x < -126.0f ? -126.0f : x;
+  x = x > 126.0f ? 126.0f : x;
+  const float m = x + 12582912.0f; // round(x) lands in the low mantissa bits
+  int32_t n;
+  std::memcpy(&n, &m, sizeof(n));
+  n -= 0x4B400000;
+  const float f = (x - (m - 12582912.0f)) * 0.69314718f; // |f| <= ln2 / 2
+  const float p = 1.0f + f * (1.0f + f * (0.5f + f * (1.6666667e-1f + f * (4.1666667e-2f +
+                  f * (8.3333333e-3f + f * 1.3888889e-3f)))));
+  const uint32_t bits = static_cast<uint32_t>(n + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+// GLSL leaves pow(x <= 0, y) undefined; 0 here. log2 of x <= 0 is finite
+// garbage, so compute unconditionally and select
+inline float pow(float x, float y) {
+  const float r = exp2(y * log2(x));
+  return x > 0.0f ? r : 0.0f;
+}
+inline float length(float x, float y) { return std::sqrt(x * x + y * y); }
+
+} // namespace math
+
+// one IR value for kLanes pixels: up to 4 components (mat2 is column-major)
+struct Value {
+  alignas(64) float c[4][kLanes];
+};
+
+// per-frame constants the structure ports read (the GLSL reads u_time)
+struct Frame {
+  float time = 0.0f;
+  int quality = 2;
+  float juliaC[2] = {0.0f, 0.0f};
+  float superellipseN = 4.0f;
+  int seedCount = 180;
+  float seedX[180] = {};
+  float seedY[180] = {};
+  float quasiDir[7][2] = {};
+
+  // float #defines from helper preambles that main() reads (footprint values)
+  bool define(const std::string &name, float &value) const {
+    if (name == "JULIA_OUTSIDE") {
+      value = 1.0f - 1.0f / float(juliaIterations());
+      return true;
+    }
+    return false;
+  }
+  int juliaIterations() const { return quality >= 2 ? 60 : (quality == 1 ? 40 : 24); }
+
+  void prepare(float t, int q) {
+    time = t;
+    quality = q;
+    juliaC[0] = -0.8f + 0.6f * std::sin(t * 0.23f);
+    juliaC[1] = 0.156f + 0.4f * std::cos(t * 0.19f);
+    superellipseN = 4.0f + 2.0f * std::sin(t * 0.4f);
+    seedCount = q >= 2 ? 180 : (q == 1 ? 128 : 96);
+    const float phi = 3.14159265359f * (3.0f - std::sqrt(5.0f));
+    for (int i = 0; i < 180; ++i) {
+      const float a = float(i) * phi + t * 0.1f;
+      seedX[i] = 0.015f * float(i) * std::cos(a);
+      seedY[i] = 0.015f * float(i) * std::sin(a);
+    }
+    for (int i = 0; i < 7; ++i) {
+      const float ang = (float(i) / 7.0f) * 3.14159265359f;
+      quasiDir[i][0] = std::cos(ang);
+      quasiDir[i][1] = std::sin(ang);
+    }
+  }
+};
+
+// helper port: args[i] are the evaluated call arguments
+using HelperFn = void (*)(const Value *const *args, Value &out, const Frame &f);
+
+// ---- structure ports (see structures.hpp for the GLSL) ---- //
+namespace ports {
+
+using namespace math;
+
+// lane loop. kept rolled: fully unrolled, gcc scalarises the per-lane arrays
+// and the loop around it (iterations, seeds, octaves) no longer vectorises
+#define SHADERCPU_LANES _Pragma("GCC unroll 1") for (int l = 0; l < kLanes; ++l)
+
+inline float hash127(float x, float y) { return fract(sin(x * 127.1f + y * 311.7f) * 43758.5453f); }
+inline float hash269(float x, float y) { return fract(sin(x * 269.5f + y * 183.3f) * 43758.5453f); }
+inline float hash41(float x, float y) { return fract(sin(x * 41.3f + y * 289.1f) * 43758.5453f); }
+
+// value noise with the given corner hash (reactionDiffusion noise / branchNoise n2)
+template <float (*H)(float, float)>
+inline float valueNoise(float x, float y) {
+  const float ix = floor(x), iy = floor(y);
+  const float fx = x - ix, fy = y - iy;
+  const float a = H(ix, iy), b = H(ix + 1.0f, iy), c = H(ix, iy + 1.0f), d = H(ix + 1.0f, iy + 1.0f);
+  const float ux = fx * fx * (3.0f - 2.0f * fx), uy = fy * fy * (3.0f - 2.0f * fy);
+  return mix(mix(a, b, ux), mix(c, d, ux), uy);
+}
+
+inline int octaves(const Frame &f) { return f.quality >= 2 ? 5 : (f.quality == 1 ? 4 : 3); }
+
+// fbm over lanes: s += a * noise(p); p *= 2.02
+inline void fbm(const float *px, const float *py, float *out, const Frame &f) {
+  float x[kLanes], y[kLanes];
+  SHADERCPU_LANES { x[l] = px[l]; y[l] = py[l]; out[l] = 0.0f; }
+  float a = 0.5f;
+  for (int o = 0, n = octaves(f); o < n; ++o) {
+    SHADERCPU_LANES {
+      out[l] += a * valueNoise<hash127>(x[l], y[l]);
+      x[l] *= 2.02f;
+      y[l] *= 2.02f;
+    }
+    a *= 0.5f;
+  }
+}
+
+inline void ridged(const float *px, const float *py, float *out, const Frame &f) {
+  float x[kLanes], y[kLanes];
+  SHADERCPU_LANES { x[l] = px[l]; y[l] = py[l]; out[l] = 0.0f; }
+  float a = 0.5f;
+  for (int o = 0, n = octaves(f); o < n; ++o) {
+    SHADERCPU_LANES {
+      out[l] += a * (1.0f - std::fabs(2.0f * valueNoise<hash41>(x[l], y[l]) - 1.0f));
+      x[l] *= 2.03f;
+      y[l] *= 2.03f;
+    }
+    a *= 0.5f;
+  }
+}
+
+inline void waveGrid(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES out.c[0][l] = sin(x[l] + sin(y[l] * 2.0f) + sin(y[l] * 0.43f));
+}
+
+inline void noiseGrid(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES out.c[0][l] = fract(sin(x[l] * 12.9898f + y[l] * 78.233f) * 43758.5453f);
+}
+
+inline void circleField(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES out.c[0][l] = length(x[l], y[l]) - 0.5f;
+}
+
+inline void blob(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES {
+    const float r = 0.5f + 0.1f * sin(f.time + x[l] * 10.0f) * cos(y[l] * 10.0f);
+    out.c[0][l] = length(x[l], y[l]) - r;
+  }
+}
+
+inline void superformula(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES {
+    const float phi = atan2(y[l], x[l]);
+    const float r = pow(pow(std::fabs(cos(6.0f * phi / 4.0f)), 1.7f) +
+                        pow(std::fabs(sin(6.0f * phi / 4.0f)), 1.7f), -1.0f / 0.3f);
+    out.c[0][l] = length(x[l], y[l]) - r;
+  }
+}
+
+inline void lissajous(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES out.c[0][l] = sin(3.0f * x[l] + kHalfPi) - sin(2.0f * y[l]);
+}
+
+inline void lorenzAttractor(const Value *const *a, Value &out, const Frame &) {
+  float vx[kLanes], vy[kLanes], vz[kLanes];
+  SHADERCPU_LANES { vx[l] = a[0]->c[0][l]; vy[l] = a[0]->c[1][l]; vz[l] = 0.1f; }
+  for (int i = 0; i < 10; ++i) {
+    SHADERCPU_LANES {
+      const float dx = 10.0f * (vy[l] - vx[l]);
+      const float dy = vx[l] * (28.0f - vz[l]) - vy[l];
+      const float dz = vx[l] * vy[l] - (8.0f / 3.0f) * vz[l];
+      vx[l] += 0.01f * dx;
+      vy[l] += 0.01f * dy;
+      vz[l] += 0.01f * dz;
+    }
+  }
+  SHADERCPU_LANES out.c[0][l] = length(vx[l], vy[l]);
+}
+
+inline void star(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES {
+    const float r = cos(5.0f * atan2(y[l], x[l])) * 0.5f + 0.5f;
+    out.c[0][l] = length(x[l], y[l]) - r;
+  }
+}
+
+inline void mandalaRadial(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  const float wedge = 6.28318530718f / 10.0f;
+  SHADERCPU_LANES {
+    float an = atan2(y[l], x[l]);
+    const float r = length(x[l], y[l]);
+    an = mod(an, wedge);
+    an = std::fabs(an - wedge * 0.5f);
+    const float ring = 0.5f + 0.5f * sin(12.0f * r - f.time * 0.6f);
+    const float petals = 0.5f + 0.5f * sin(8.0f * an + r * 6.0f);
+    out.c[0][l] = ring * petals - 0.5f;
+  }
+}
+
+inline void quasicrystal(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  float sum[kLanes] = {};
+  for (int i = 0; i < 7; ++i) {
+    const float dx = f.quasiDir[i][0] * 6.0f, dy = f.quasiDir[i][1] * 6.0f;
+    SHADERCPU_LANES sum[l] += cos(x[l] * dx + y[l] * dy + f.time * 0.2f);
+  }
+  SHADERCPU_LANES out.c[0][l] = sum[l] / 7.0f;
+}
+
+inline void voronoi(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  float gx[kLanes], gy[kLanes], fx[kLanes], fy[kLanes], d[kLanes], bx[kLanes], by[kLanes];
+  const bool full = f.quality >= 2;
+  SHADERCPU_LANES {
+    gx[l] = floor(x[l] * 4.0f);
+    gy[l] = floor(y[l] * 4.0f);
+    fx[l] = x[l] * 4.0f - gx[l];
+    fy[l] = y[l] * 4.0f - gy[l];
+    d[l] = 1e9f;
+    // 3x3 search starts at -1; the 2x2 tier at the side of the nearest edges
+    bx[l] = full ? -1.0f : step(0.5f, fx[l]) - 1.0f;
+    by[l] = full ? -1.0f : step(0.5f, fy[l]) - 1.0f;
+  }
+  const int n = full ? 3 : 2;
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < n; ++i) {
+      SHADERCPU_LANES {
+        const float ox = bx[l] + float(i), oy = by[l] + float(j);
+        const float hn = hash127(gx[l] + ox, gy[l] + oy);
+        const float hm = hash269(gx[l] + ox, gy[l] + oy);
+        const float rx = ox + hn - fx[l], ry = oy + hm - fy[l];
+        d[l] = std::min(d[l], rx * rx + ry * ry);
+      }
+    }
+  }
+  SHADERCPU_LANES out.c[0][l] = 1.0f - std::sqrt(d[l]);
+}
+
+inline void roseCurve(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  SHADERCPU_LANES {
+    const float target = 0.6f * std::fabs(cos(7.0f * atan2(y[l], x[l])));
+    out.c[0][l] = length(x[l], y[l]) - target;
+  }
+}
+
+inline void superellipse(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  const float n = f.superellipseN;
+  SHADERCPU_LANES {
+    out.c[0][l] = pow(std::fabs(x[l] / 0.7f), n) + pow(std::fabs(y[l] / 0.7f), n) - 1.0f;
+  }
+}
+
+inline void phyllotaxis(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  float d2[kLanes];
+  SHADERCPU_LANES d2[l] = 1e18f;
+  // seeds are the same for every pixel, so min over squared distances and
+  // take one sqrt at the end
+  for (int i = 0; i < f.seedCount; ++i) {
+    const float sx = f.seedX[i], sy = f.seedY[i];
+    SHADERCPU_LANES {
+      const float dx = x[l] - sx, dy = y[l] - sy;
+      d2[l] = std::min(d2[l], dx * dx + dy * dy);
+    }
+  }
+  SHADERCPU_LANES out.c[0][l] = 0.5f - std::sqrt(d2[l]) * 3.0f;
+}
+
+inline void julia(const Value *const *a, Value &out, const Frame &f) {
+  float zx[kLanes], zy[kLanes], iter[kLanes], live[kLanes];
+  SHADERCPU_LANES {
+    zx[l] = a[0]->c[0][l] * 1.6f;
+    zy[l] = a[0]->c[1][l] * 1.6f;
+    iter[l] = 0.0f;
+    live[l] = 1.0f;
+  }
+  const int n = f.juliaIterations();
+  const float cx = f.juliaC[0], cy = f.juliaC[1];
+  // the GLSL breaks per pixel; lanes that escaped just stop updating
+  for (int i = 0; i < n; ++i) {
+    SHADERCPU_LANES {
+      const float nx = zx[l] * zx[l] - zy[l] * zy[l] + cx;
+      const float ny = 2.0f * zx[l] * zy[l] + cy;
+      const bool on = live[l] > 0.0f;
+      zx[l] = on ? nx : zx[l];
+      zy[l] = on ? ny : zy[l];
+      iter[l] += live[l];
+      live[l] = (on && nx * nx + ny * ny <= 16.0f) ? 1.0f : 0.0f;
+    }
+  }
+  SHADERCPU_LANES out.c[0][l] = 1.0f - clamp(iter[l] / float(n), 0.0f, 1.0f);
+}
+
+inline void reactionDiffusion(const Value *const *a, Value &out, const Frame &f) {
+  float px[kLanes], py[kLanes], qx[kLanes], qy[kLanes], u[kLanes], v[kLanes], w[kLanes];
+  const float t = f.time * 0.2f;
+  SHADERCPU_LANES {
+    px[l] = a[0]->c[0][l] * 3.0f;
+    py[l] = a[0]->c[1][l] * 3.0f;
+    qx[l] = px[l] + t;
+    qy[l] = py[l] - t;
+  }
+  fbm(qx, qy, u, f);
+  SHADERCPU_LANES {
+    // rot * (p * 1.9), rot = mat2(0.5, 0.86, -0.86, 0.5)
+    const float sx = px[l] * 1.9f, sy = py[l] * 1.9f;
+    qx[l] = 0.5f * sx - 0.86f * sy - t;
+    qy[l] = 0.86f * sx + 0.5f * sy + t;
+  }
+  fbm(qx, qy, v, f);
+  SHADERCPU_LANES {
+    qx[l] = (px[l] + u[l]) * 1.2f;
+    qy[l] = (py[l] + v[l]) * 1.2f;
+  }
+  fbm(qx, qy, w, f);
+  SHADERCPU_LANES out.c[0][l] = smoothstep(0.35f, 0.65f, w[l]) - 0.5f;
+}
+
+inline void branchNoise(const Value *const *a, Value &out, const Frame &f) {
+  const float *x = a[0]->c[0], *y = a[0]->c[1];
+  float r[kLanes], an[kLanes], qx[kLanes], qy[kLanes], bark[kLanes], veins[kLanes];
+  SHADERCPU_LANES {
+    r[l] = length(x[l], y[l]) + 1e-3f;
+    an[l] = atan2(y[l], x[l]);
+    qx[l] = x[l] * 2.0f;
+    qy[l] = y[l] * 4.0f + f.time * 0.15f;
+  }
+  ridged(qx, qy, bark, f);
+  SHADERCPU_LANES {
+    qx[l] = an[l] * 1.5f;
+    qy[l] = r[l] * 3.0f;
+  }
+  ridged(qx, qy, veins, f);
+  SHADERCPU_LANES {
+    const float dir = cos(an[l] * 5.0f) * 0.5f + 0.5f;
+    const float trunk = (0.35f / r[l]) * dir;
+    out.c[0][l] = trunk + 0.5f * veins[l] + 0.3f * bark[l] - 0.8f;
+  }
+}
+
+// textures::fbmTone
+inline void fbmTone(const Value *const *a, Value &out, const Frame &) {
+  const float *x = a[0]->c[0];
+  SHADERCPU_LANES out.c[0][l] = 0.5f + 0.5f * sin(6.28318f * x[l] + 2.0f * x[l]);
+}
+
+// layering::blendOverlay
+inline void blendOverlay(const Value *const *a, Value &out, const Frame &) {
+  for (int k = 0; k < 3; ++k) {
+    const float *b = a[0]->c[k], *s = a[1]->c[k];
+    SHADERCPU_LANES {
+      const float lo = 2.0f * b[l] * s[l];
+      const float hi = 1.0f - 2.0f * (1.0f - b[l]) * (1.0f - s[l]);
+      out.c[k][l] = b[l] < 0.5f ? lo : hi;
+    }
+  }
+}
+
+#undef SHADERCPU_LANES
+
+} // namespace ports
+
+// helper name -> port. names are the HelperDef names the GLSL uses
+inline const std::unordered_map<std::string_view, HelperFn> &helperTable() {
+  static const std::unordered_map<std::string_view, HelperFn> table = {
+      {"waveGrid", ports::waveGrid},         {"noiseGrid", ports::noiseGrid},
+      {"circleField", ports::circleField},   {"blob", ports::blob},
+      {"superformula", ports::superformula}, {"lissajous", ports::lissajous},
+      {"lorenzAttractor", ports::lorenzAttractor}, {"star", ports::star},
+      {"mandalaRadial", ports::mandalaRadial}, {"quasicrystal", ports::quasicrystal},
+      {"voronoi", ports::voronoi},           {"roseCurve", ports::roseCurve},
+      {"superellipse", ports::superellipse}, {"phyllotaxis", ports::phyllotaxis},
+      {"julia", ports::julia},               {"reactionDiffusion", ports::reactionDiffusion},
+      {"branchNoise", ports::branchNoise},   {"fbmTone", ports::fbmTone},
+      {"blendOverlay", ports::blendOverlay},
+  };
+  return table;
+}
+
+// how uv (vPos.xy) is produced for each output pixel
+enum class Projection {
+  Planar,  ///< fullscreen quad: uv in [-1, 1] (x scaled by aspect)
+  Equirect ///< ShadedSphere unwrapped: lon/lat -> vPos on a sphere of sphereRadius
+};
+
+struct RenderOptions {
+  int width = 512;
+  int height = 512;
+  unsigned threads = 0; ///< 0 -> hardware_concurrency
+  Projection projection = Projection::Planar;
+  float sphereRadius = 15.0f; ///< ShadedSphere::setSphere radius
+  int quality = 2;            ///< same as GeneratorOptions::quality
+  bool useSymmetry = true;    ///< evaluate one copy of mirrored regions (detectSymmetry)
+  std::unordered_map<std::string, float> uniforms; ///< besides u_time
+};
+
+// linear RGB, rows top to bottom, unclamped like fragColor
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<float> rgb;
+};
+
+// mirror symmetry of a whole program's output. the symmetry emitter folds the
+// shared uv with abs(), and that carries over to every later element, so the
+// image is mirrored on an axis when no statement reads that uv component
+// before it is folded. (element 0 reading uv and element 1 folding it is not
+// symmetric; the other way round is)
+struct Symmetry {
+  bool mirrorX = false; ///< f(-x, y) == f(x, y)
+  bool mirrorY = false; ///< f(x, -y) == f(x, y)
+};
+
+namespace detail {
+
+// which uv components e reads: bit 0 = x, bit 1 = y
+inline int uvReads(const shaderIR::Program &p, shaderIR::ExprId id) {
+  const shaderIR::Expr &e = p.exprs[id];
+  if (e.op == shaderIR::Op::Var) {
+    if (e.var.kind != shaderIR::VarKind::UV) return 0;
+    return e.var.component < 0 ? 3 : (1 << e.var.component);
+  }
+  int mask = 0;
+  for (int i = 0; i < e.argc; ++i) mask |= uvReads(p, e.args[i]);
+  return mask;
+}
+
+// uv = abs(uv) / uv.x = abs(uv.x) / uv.y = abs(uv.y): the axes it folds
+inline int uvFold(const shaderIR::Program &p, const shaderIR::Stmt &s) {
+  if (s.op != shaderIR::StmtOp::Assign || s.target.kind != shaderIR::VarKind::UV) return 0;
+  const shaderIR::Expr &e = p.exprs[s.value];
+  if (e.op != shaderIR::Op::Call || e.fn != shaderIR::Fn::Abs) return 0;
+  const shaderIR::Expr &a = p.exprs[e.args[0]];
+  if (a.op != shaderIR::Op::Var || !shaderIR::sameVar(a.var, s.target)) return 0;
+  return s.target.component < 0 ? 3 : (1 << s.target.component);
+}
+
+} // namespace detail
+
+inline Symmetry detectSymmetry(const shaderIR::Program &p) {
+  int folded = 0, broken = 0;
+  for (const shaderIR::Stmt &s : p.stmts) {
+    if (s.op == shaderIR::StmtOp::Comment) continue;
+    if (const int fold = detail::uvFold(p, s)) {
+      folded |= fold;
+      continue;
+    }
+    broken |= detail::uvReads(p, s.value) & ~folded;
+    if (s.guarded()) broken |= detail::uvReads(p, s.guard) & ~folded;
+    if (s.target.kind == shaderIR::VarKind::UV) broken = 3; // any other uv write: give up
+  }
+  return Symmetry{!(broken & 1), !(broken & 2)};
+}
+
+/**
+ * @brief A template compiled for the CPU. Build once, render() per frame.
+ */
+class Renderer {
+public:
+  Renderer(const ShaderTemplate &tmpl, RenderOptions options = {})
+      : mOptions(std::move(options)) {
+    shaderLib::buildTemplate(mIR, tmpl);
+    shaderIR::optimize(mIR);
+    prepare(tmpl);
+  }
+
+  const RenderOptions &options() const { return mOptions; }
+  const shaderIR::Program &program() const { return mIR; }
+  const Symmetry &symmetry() const { return mSymmetry; }
+  /// pixels actually evaluated by the last render(); the rest were mirrored
+  size_t evaluatedPixels() const { return mRows.size() * mColumnCount; }
+
+  void setUniform(const std::string &name, float value) {
+    mOptions.uniforms[name] = value;
+    resolveUniforms();
+  }
+
+  /// one frame at u_time = time
+  void render(float time, Image &image) {
+    mOptions.uniforms["u_time"] = time;
+    mFrame.prepare(time, mOptions.quality);
+    resolveUniforms();
+    updateInvariants();
+
+    image.width = mOptions.width;
+    image.height = mOptions.height;
+    image.rgb.assign(size_t(image.width) * size_t(image.height) * 3, 0.0f);
+
+    buildPixelMap(image.width, image.height);
+    forEachRow(mRows.size(), [&](size_t i, Scratch &s) { renderRow(mRows[i], image, s); });
+
+    const size_t rowFloats = size_t(image.width) * 3;
+    for (int y = 0; y < image.height; ++y) {
+      if (mRowSource[y] == y) continue;
+      std::copy_n(&image.rgb[mRowSource[y] * rowFloats], rowFloats, &image.rgb[y * rowFloats]);
+    }
+  }
+
+  Image render(float time) {
+    Image image;
+    render(time, image);
+    return image;
+  }
+
+  /// the final values of some variables (element locals, normally) over a
+  /// size x size grid of uv in [-extent, extent]^2, rows bottom to top like a
+  /// GL texture. out gets the vars' components back to back per texel.
+  /// Statements after the last write of any of them are skipped.
+  /// Used to bake static layers (ShaderBake.hpp)
+  void sampleVars(float time, int size, float extent, const std::vector<shaderIR::Var> &vars,
+                  std::vector<float> &out) {
+    mOptions.uniforms["u_time"] = time;
+    mFrame.prepare(time, mOptions.quality);
+    resolveUniforms();
+    updateInvariants();
+
+    int channels = 0;
+    for (const shaderIR::Var &v : vars) channels += width(shaderIR::varType(v));
+    size_t end = 0;
+    for (size_t i = 0; i < mIR.stmts.size(); ++i) {
+      const shaderIR::Stmt &st = mIR.stmts[i];
+      if (st.op == shaderIR::StmtOp::Comment) continue;
+      for (const shaderIR::Var &v : vars) {
+        if (shaderIR::sameStorage(st.target, v)) end = i + 1;
+      }
+    }
+    out.assign(size_t(size) * size_t(size) * size_t(channels), 0.0f);
+
+    forEachRow(static_cast<size_t>(size), [&](size_t row, Scratch &s) {
+      Value &uv = s.vars[slot(shaderIR::Var::uv())];
+      const float y = ((float(row) + 0.5f) / float(size) * 2.0f - 1.0f) * extent;
+      for (int x0 = 0; x0 < size; x0 += kLanes) {
+        const int n = std::min(kLanes, size - x0);
+        for (int l = 0; l < kLanes; ++l) {
+          uv.c[0][l] = ((float(x0 + std::min(l, n - 1)) + 0.5f) / float(size) * 2.0f - 1.0f) * extent;
+          uv.c[1][l] = y;
+        }
+        splat(s.vars[slot(shaderIR::Var::col())], 3, 0.0f);
+        for (size_t i = 0; i < end; ++i) exec(mIR.stmts[i], s);
+
+        float *texel = &out[(row * size_t(size) + size_t(x0)) * size_t(channels)];
+        for (int l = 0; l < n; ++l) {
+          for (const shaderIR::Var &v : vars) {
+            const Value &value = s.vars[slot(v)];
+            for (int k = 0, w = width(shaderIR::varType(v)); k < w; ++k) *texel++ = value.c[k][l];
+          }
+        }
+      }
+    });
+  }
+
+private:
+  // per-thread storage: one Value per variable slot + a stack for temporaries
+  struct Scratch {
+    Scratch(int slots, int depth) : vars(slots), temps(depth) {}
+    std::vector<Value> vars;
+    std::vector<Value> temps;
+    int top = 0;
+  };
+
+  static int width(shaderIR::Type t) {
+    switch (t) {
+    case shaderIR::Type::Vec2: return 2;
+    case shaderIR::Type::Vec3: return 3;
+    case shaderIR::Type::Mat2: return 4;
+    default: return 1;
+    }
+  }
+  static int slot(const shaderIR::Var &v) { return shaderIR::varSlot(v); }
+
+  // work(i, scratch) for i in [0, count), handed out to the thread pool
+  template <typename Work> void forEachRow(size_t count, Work &&work) const {
+    unsigned threads = mOptions.threads ? mOptions.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(count)));
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+      Scratch scratch(mSlots, mTemps);
+      for (size_t i; (i = next.fetch_add(1)) < count;) work(i, scratch);
+    };
+    if (threads == 1) {
+      worker();
+      return;
+    }
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i) pool.emplace_back(worker);
+    for (auto &t : pool) t.join();
+  }
+
+  void prepare(const ShaderTemplate &tmpl) {
+    int maxElement = -1;
+    for (const auto &s : mIR.stmts) maxElement = std::max<int>(maxElement, s.element);
+    mSlots = shaderIR::varSlotCount(maxElement);
+    findInvariants();
+    mSymmetry = detectSymmetry(mIR);
+
+    for (int i = 0; i < static_cast<int>(tmpl.colorPalette.size()) && i < 8; ++i) {
+      const auto &c = tmpl.colorPalette[i];
+      if (c.size() != 3) continue;
+      for (int k = 0; k < 3; ++k) mPalette[i][k] = c[k];
+    }
+    mHasBackground = tmpl.hasBackground &&
+                     std::sscanf(tmpl.backgroundColor.c_str(), " ( %f , %f , %f )", &mBackground[0],
+                                 &mBackground[1], &mBackground[2]) == 3;
+
+    mHelpers.assign(mIR.exprs.size(), nullptr);
+    for (size_t i = 0; i < mIR.exprs.size(); ++i) {
+      const shaderIR::Expr &e = mIR.exprs[i];
+      if (e.op != shaderIR::Op::Call || e.fn != shaderIR::Fn::Helper) continue;
+      auto it = helperTable().find(e.helper->name);
+      if (it != helperTable().end()) mHelpers[i] = it->second;
+      else std::cerr << "WARNING: no CPU port for helper " << e.helper->name << std::endl;
+    }
+    resolveUniforms();
+  }
+
+  // expressions that read no variable (constants, uniforms, palette, drive =
+  // u * speed, ...) are the same for every pixel: the outermost ones get a
+  // slot in mInvariants, filled once per frame by updateInvariants()
+  void findInvariants() {
+    using shaderIR::Op;
+    const size_t n = mIR.exprs.size();
+    std::vector<char> invariant(n, 0), root(n, 0);
+    for (size_t i = 0; i < n; ++i) { // args always precede their users
+      const shaderIR::Expr &e = mIR.exprs[i];
+      bool inv = e.op != Op::Var;
+      for (int a = 0; a < e.argc; ++a) inv = inv && invariant[e.args[a]];
+      invariant[i] = inv;
+      if (inv) continue;
+      for (int a = 0; a < e.argc; ++a) root[e.args[a]] = invariant[e.args[a]];
+    }
+    for (const auto &st : mIR.stmts) {
+      if (st.op == shaderIR::StmtOp::Comment) continue;
+      root[st.value] = invariant[st.value];
+      if (st.guarded()) root[st.guard] = invariant[st.guard];
+    }
+    mInvariantSlot.assign(n, -1);
+    int count = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (root[i]) mInvariantSlot[i] = count++;
+    }
+    mInvariants.resize(count);
+
+    mTemps = 1;
+    for (size_t i = 0; i < n; ++i) {
+      if (root[i]) mTemps = std::max(mTemps, temporaries(static_cast<shaderIR::ExprId>(i), true));
+    }
+    for (const auto &st : mIR.stmts) {
+      if (st.op == shaderIR::StmtOp::Comment) continue;
+      const int guard = st.guarded() ? temporaries(st.guard) : 0; // stays on the stack
+      mTemps = std::max(mTemps, guard + temporaries(st.value));
+    }
+  }
+
+  void updateInvariants() {
+    Scratch s(0, mTemps);
+    for (size_t i = 0; i < mInvariantSlot.size(); ++i) { // inner roots first
+      if (mInvariantSlot[i] < 0) continue;
+      s.top = 0;
+      mInvariants[mInvariantSlot[i]] = compute(static_cast<shaderIR::ExprId>(i), s);
+    }
+  }
+
+  void resolveUniforms() {
+    mUniform.assign(mIR.exprs.size(), 0.0f);
+    for (size_t i = 0; i < mIR.exprs.size(); ++i) {
+      const shaderIR::Expr &e = mIR.exprs[i];
+      if (e.op != shaderIR::Op::Uniform) continue;
+      const std::string name(mIR.text(e.symbol));
+      auto it = mOptions.uniforms.find(name);
+      if (it != mOptions.uniforms.end()) mUniform[i] = it->second;
+      else if (!mFrame.define(name, mUniform[i])) mUniform[i] = 0.0f;
+    }
+  }
+
+  // scratch Values eval() takes for an expression: one per node that isn't a
+  // whole variable or a per-frame invariant (unless that's the node computed)
+  int temporaries(shaderIR::ExprId id, bool computed = false) const {
+    const shaderIR::Expr &e = mIR.exprs[id];
+    if (e.op == shaderIR::Op::Var && e.var.component < 0) return 0;
+    if (!computed && mInvariantSlot[id] >= 0) return 0;
+    int n = 1;
+    for (int i = 0; i < e.argc; ++i) n += temporaries(e.args[i]);
+    return n;
+  }
+
+  static void splat(Value &v, int comps, float x) {
+    for (int k = 0; k < comps; ++k) std::fill(v.c[k], v.c[k] + kLanes, x);
+  }
+
+  // evaluate e into a Value; variables and invariants are returned in place,
+  // everything else lands on the scratch stack (reset after each statement)
+  const Value &eval(shaderIR::ExprId id, Scratch &s) const {
+    const shaderIR::Expr &e = mIR.exprs[id];
+    if (e.op == shaderIR::Op::Var && e.var.component < 0) return s.vars[slot(e.var)];
+    if (mInvariantSlot[id] >= 0) return mInvariants[mInvariantSlot[id]];
+    return compute(id, s);
+  }
+
+  const Value &compute(shaderIR::ExprId id, Scratch &s) const {
+    using shaderIR::Op;
+    const shaderIR::Expr &e = mIR.exprs[id];
+    Value &out = s.temps[s.top++];
+    const int w = width(e.type);
+    switch (e.op) {
+    case Op::Const: splat(out, 1, static_cast<float>(e.value)); break;
+    case Op::Uniform: splat(out, 1, mUniform[id]); break;
+    case Op::Palette:
+      for (int k = 0; k < 3; ++k) std::fill(out.c[k], out.c[k] + kLanes, mPalette[e.palette & 7][k]);
+      break;
+    case Op::Var: { // single component
+      const float *src = s.vars[slot(e.var)].c[e.var.component];
+      std::copy(src, src + kLanes, out.c[0]);
+      break;
+    }
+    case Op::Neg: {
+      const Value &a = eval(e.args[0], s);
+      for (int k = 0; k < w; ++k)
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = -a.c[k][l];
+      break;
+    }
+    case Op::Add:
+    case Op::Sub:
+    case Op::Mul:
+    case Op::Div: binary(e, eval(e.args[0], s), eval(e.args[1], s), out); break;
+    case Op::Call: {
+      const Value *args[4];
+      for (int i = 0; i < e.argc; ++i) args[i] = &eval(e.args[i], s);
+      call(e, id, args, out);
+      break;
+    }
+    }
+    return out;
+  }
+
+  void binary(const shaderIR::Expr &e, const Value &a, const Value &b, Value &out) const {
+    using shaderIR::Op;
+    using shaderIR::Type;
+    const Type ta = mIR.exprs[e.args[0]].type, tb = mIR.exprs[e.args[1]].type;
+    if (e.op == Op::Mul && ta == Type::Mat2 && tb == Type::Vec2) {
+      for (int l = 0; l < kLanes; ++l) {
+        const float x = b.c[0][l], y = b.c[1][l];
+        out.c[0][l] = a.c[0][l] * x + a.c[2][l] * y;
+        out.c[1][l] = a.c[1][l] * x + a.c[3][l] * y;
+      }
+      return;
+    }
+    const int w = width(e.type);
+    const bool sa = width(ta) == 1, sb = width(tb) == 1; // scalars broadcast
+    for (int k = 0; k < w; ++k) {
+      const float *x = a.c[sa ? 0 : k], *y = b.c[sb ? 0 : k];
+      float *o = out.c[k];
+      switch (e.op) {
+      case Op::Add: for (int l = 0; l < kLanes; ++l) o[l] = x[l] + y[l]; break;
+      case Op::Sub: for (int l = 0; l < kLanes; ++l) o[l] = x[l] - y[l]; break;
+      case Op::Mul: for (int l = 0; l < kLanes; ++l) o[l] = x[l] * y[l]; break;
+      default: for (int l = 0; l < kLanes; ++l) o[l] = x[l] / y[l]; break;
+      }
+    }
+  }
+
+  void call(const shaderIR::Expr &e, shaderIR::ExprId id, const Value *const *args, Value &out) const {
+    using shaderIR::Fn;
+    const int w = width(e.type);
+    auto argWidth = [&](int i) { return width(mIR.exprs[e.args[i]].type); };
+    auto comp = [&](int i, int k) { return args[i]->c[argWidth(i) == 1 ? 0 : k]; };
+    switch (e.fn) {
+    case Fn::Helper:
+      if (mHelpers[id]) mHelpers[id](args, out, mFrame);
+      else splat(out, w, 0.0f);
+      break;
+    case Fn::Abs:
+      for (int k = 0; k < w; ++k)
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = std::fabs(args[0]->c[k][l]);
+      break;
+    case Fn::Sin:
+      for (int k = 0; k < w; ++k)
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = math::sin(args[0]->c[k][l]);
+      break;
+    case Fn::Cos:
+      for (int k = 0; k < w; ++k)
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = math::cos(args[0]->c[k][l]);
+      break;
+    case Fn::Step:
+      for (int k = 0; k < w; ++k) {
+        const float *edge = comp(0, k), *x = comp(1, k);
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = math::step(edge[l], x[l]);
+      }
+      break;
+    case Fn::Smoothstep:
+      for (int k = 0; k < w; ++k) {
+        const float *e0 = comp(0, k), *e1 = comp(1, k), *x = comp(2, k);
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = math::smoothstep(e0[l], e1[l], x[l]);
+      }
+      break;
+    case Fn::Mix:
+      for (int k = 0; k < w; ++k) {
+        const float *a = comp(0, k), *b = comp(1, k), *t = comp(2, k);
+        for (int l = 0; l < kLanes; ++l) out.c[k][l] = math::mix(a[l], b[l], t[l]);
+      }
+      break;
+    case Fn::Dot: {
+      const int n = argWidth(0);
+      std::fill(out.c[0], out.c[0] + kLanes, 0.0f);
+      for (int k = 0; k < n; ++k) {
+        const float *a = args[0]->c[k], *b = args[1]->c[k];
+        for (int l = 0; l < kLanes; ++l) out.c[0][l] += a[l] * b[l];
+      }
+      break;
+    }
+    case Fn::Texture: // baked layers only exist in GLSL; Renderer always builds from the template
+      splat(out, w, 0.0f);
+      break;
+    case Fn::Vec2:
+    case Fn::Vec3:
+    case Fn::Mat2: {
+      if (e.argc == 1 && argWidth(0) == 1) { // vecN(x)
+        for (int k = 0; k < w; ++k) std::copy(args[0]->c[0], args[0]->c[0] + kLanes, out.c[k]);
+        break;
+      }
+      int k = 0; // concatenate argument components
+      for (int i = 0; i < e.argc && k < w; ++i)
+        for (int j = 0; j < argWidth(i) && k < w; ++j, ++k)
+          std::copy(args[i]->c[j], args[i]->c[j] + kLanes, out.c[k]);
+      break;
+    }
+    }
+  }
+
+  void exec(const shaderIR::Stmt &st, Scratch &s) const {
+    using shaderIR::StmtOp;
+    if (st.op == StmtOp::Comment) return;
+    s.top = 0;
+    float inside[kLanes];
+    if (st.guarded()) {
+      // footprint culling: skip the value entirely when no lane is inside
+      const Value &g = eval(st.guard, s);
+      const float below = static_cast<float>(st.guardBelow);
+      int any = 0;
+      for (int l = 0; l < kLanes; ++l) {
+        inside[l] = g.c[0][l] < below ? 1.0f : 0.0f;
+        any += g.c[0][l] < below;
+      }
+      if (!any) return;
+    }
+    const Value &v = eval(st.value, s);
+    Value &dst = s.vars[slot(st.target)];
+    if (st.guarded()) { // only plain assigns are guarded
+      for (int k = 0, w = width(shaderIR::storageType(st.target.kind)); k < w; ++k) {
+        float *d = dst.c[k];
+        const float *x = v.c[width(mIR.exprs[st.value].type) == 1 ? 0 : k];
+        for (int l = 0; l < kLanes; ++l) d[l] = inside[l] > 0.0f ? x[l] : d[l];
+      }
+      return;
+    }
+    const bool part = st.target.component >= 0;
+    const int w = part ? 1 : width(shaderIR::storageType(st.target.kind));
+    const bool scalar = width(mIR.exprs[st.value].type) == 1;
+    for (int k = 0; k < w; ++k) {
+      float *d = dst.c[part ? st.target.component : k];
+      const float *x = v.c[scalar ? 0 : k];
+      switch (st.op) {
+      case StmtOp::AddAssign: for (int l = 0; l < kLanes; ++l) d[l] += x[l]; break;
+      case StmtOp::MulAssign: for (int l = 0; l < kLanes; ++l) d[l] *= x[l]; break;
+      default: std::copy(x, x + kLanes, d); break;
+      }
+    }
+  }
+
+  // which pixel each row / column copies from (itself if it's evaluated).
+  // mirroring is exact: projectRow() gives mirrored pixels exactly negated uv,
+  // so the image is bit-identical to evaluating every pixel
+  void buildPixelMap(int width, int height) {
+    const bool sym = mOptions.useSymmetry;
+    std::vector<int> mirrors; // column reflections x -> c - x
+    if (sym && mSymmetry.mirrorX) mirrors.push_back(width - 1);
+    if (sym && mOptions.projection == Projection::Equirect && width % 2 == 0) {
+      // uv only sees sin(lon): lon and 180 - lon land on the same uv, for
+      // every template. reflections about 90 and 270 degrees
+      mirrors.push_back(width / 2 - 1);
+      mirrors.push_back(width + width / 2 - 1);
+    }
+    mColumnSource.resize(width);
+    for (int x = 0; x < width; ++x) {
+      // smallest column in x's orbit under the reflections (a handful of steps)
+      int best = x;
+      std::vector<int> orbit{x};
+      for (size_t i = 0; i < orbit.size(); ++i) {
+        for (int c : mirrors) {
+          const int m = c - orbit[i];
+          if (m < 0 || m >= width || std::find(orbit.begin(), orbit.end(), m) != orbit.end()) continue;
+          orbit.push_back(m);
+          best = std::min(best, m);
+        }
+      }
+      mColumnSource[x] = best;
+    }
+    mColumnCount = 0;
+    for (int x = 0; x < width; ++x) mColumnCount += mColumnSource[x] == x;
+
+    mRowSource.resize(height);
+    mRows.clear();
+    for (int y = 0; y < height; ++y) {
+      mRowSource[y] = (sym && mSymmetry.mirrorY) ? std::min(y, height - 1 - y) : y;
+      if (mRowSource[y] == y) mRows.push_back(y);
+    }
+  }
+
+  // vPos.xy for pixels [x0, x0 + n) of row; lanes past n repeat the last one
+  void projectRow(int row, int x0, int n, Value &uv) const {
+    const float W = float(mOptions.width), H = float(mOptions.height);
+    for (int l = 0; l < kLanes; ++l) {
+      // offsets from the centre are exact halves, so mirrored pixels get
+      // exactly negated coordinates
+      const float px = float(x0 + std::min(l, n - 1)) + 0.5f - 0.5f * W;
+      const float py = float(row) + 0.5f - 0.5f * H;
+      if (mOptions.projection == Projection::Planar) {
+        uv.c[0][l] = px * (2.0f / H);
+        uv.c[1][l] = -py * (2.0f / H);
+      } else {
+        // ShadedSphere::addTexSphere: theta = lat * PI, phi = lon * 2PI,
+        // position = r * (sin(phi) sin(theta), cos(theta), cos(phi) sin(theta)).
+        // written as cos/sin of offsets from the equator and from lon 90/270,
+        // which mirrored pixels negate exactly
+        const float v = py * (math::kPi / H);
+        const float sinTheta = std::cos(v), cosTheta = -std::sin(v);
+        const float q = (px < 0.0f ? px + 0.25f * W : px - 0.25f * W) * (math::kTwoPi / W);
+        const float sinPhi = px < 0.0f ? std::cos(q) : -std::cos(q);
+        uv.c[0][l] = mOptions.sphereRadius * sinPhi * sinTheta;
+        uv.c[1][l] = mOptions.sphereRadius * cosTheta;
+      }
+    }
+  }
+
+  void renderRow(int row, Image &image, Scratch &s) const {
+    Value &uv = s.vars[slot(shaderIR::Var::uv())];
+    Value &col = s.vars[slot(shaderIR::Var::col())];
+    float *rowOut = &image.rgb[size_t(row) * image.width * 3];
+    for (int x0 = 0; x0 < image.width;) {
+      if (mColumnSource[x0] != x0) {
+        ++x0;
+        continue;
+      }
+      // run of evaluated columns, at most one batch
+      int n = 1;
+      while (n < kLanes && x0 + n < image.width && mColumnSource[x0 + n] == x0 + n) ++n;
+      projectRow(row, x0, n, uv);
+      splat(col, 3, 0.0f);
+      for (const shaderIR::Stmt &st : mIR.stmts) exec(st, s);
+
+      float *out = rowOut + size_t(x0) * 3;
+      for (int l = 0; l < n; ++l) {
+        for (int k = 0; k < 3; ++k) {
+          float c = col.c[k][l];
+          if (mHasBackground) c = math::mix(c, mBackground[k], 0.1f);
+          out[l * 3 + k] = c;
+        }
+      }
+      x0 += n;
+    }
+    for (int x = 0; x < image.width; ++x) {
+      if (mColumnSource[x] == x) continue;
+      std::copy_n(rowOut + size_t(mColumnSource[x]) * 3, 3, rowOut + size_t(x) * 3);
+    }
+  }
+
+  RenderOptions mOptions;
+  shaderIR::Program mIR;
+  int mSlots = 0;
+  int mTemps = 1;
+  float mPalette[8][3] = {};
+  bool mHasBackground = false;
+  float mBackground[3] = {0.0f, 0.0f, 0.0f};
+  std::vector<HelperFn> mHelpers; ///< by ExprId
+  std::vector<float> mUniform;    ///< by ExprId
+  std::vector<int> mInvariantSlot; ///< by ExprId, -1 if per pixel
+  std::vector<Value> mInvariants;  ///< per frame, splatted across lanes
+  Symmetry mSymmetry;
+  std::vector<int> mColumnSource; ///< per column: column it copies (itself if evaluated)
+  std::vector<int> mRowSource;    ///< per row, same
+  std::vector<int> mRows;         ///< rows evaluated
+  size_t mColumnCount = 0;        ///< columns evaluated
+  Frame mFrame;
+};
+
+// one-shot: compile + render a single frame
+inline Image renderTemplate(const ShaderTemplate &tmpl, float time, const RenderOptions &options = {}) {
+  Renderer renderer(tmpl, options);
+  return renderer.render(time);
+}
+
+// binary PPM, clamped to [0, 1] like an 8-bit framebuffer
+inline bool writePPM(const std::string &path, const Image &image) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return false;
+  }
+  out << "P6\n" << image.width << " " << image.height << "\n255\n";
+  std::vector<unsigned char> bytes(image.rgb.size());
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<unsigned char>(math::clamp(image.rgb[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+  out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return static_cast<bool>(out);
+}
+
+} // namespace shaderCPU
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+// === Content-addressed GLSL cache === //
+// generateShaderCode is a pure function of the template and its
+// GeneratorOptions, so its output can be keyed by a hash of the two. The key is
+// built from a canonical text form of the template:
+//   - element order kept (layering depends on it)
+//   - defaults filled in the same way the emitters fill them (size 0 -> 1.0,
+//     size/placement clamped, missing placement -> origin)
+//   - floats printed at the precision the emitters print them, so two
+//     templates that emit the same GLSL get the same key
+//   - fields the emitters ignore (speed with no behavior) left out
+//   - then the options: optimize, quality, uniformBlock, and with a budget set
+//     the budget, downgrade policy and the calibration it is measured with
+// Lookups hit an in-memory LRU first, then <cacheDir>/<hash>.frag on disk, and
+// only run the emitters on a full miss. The hash only finds the entry: each one
+// keeps its canonical string (in memory, and in a <hash>.key file next to the
+// .frag) and a hit counts only when it matches, so a hash collision or a stale
+// file from another generator version is a miss, never the wrong shader.
+
+namespace shaderLib {
+
+namespace cache {
+
+// fixed 6 decimals (std::to_string / glslFloat precision), no "-0.000000"
+inline std::string canonicalFixed(double x) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.6f", x);
+  std::string s = buf;
+  if (s == "-0.000000") s = "0.000000";
+  return s;
+}
+
+// 6 significant digits (default ostream precision, used for the palette)
+inline std::string canonicalGeneral(double x) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%g", x);
+  std::string s = buf;
+  if (s == "-0") s = "0";
+  return s;
+}
+
+inline void appendElement(std::string &out, const ShaderElement &e) {
+  // mirror structures::emitElementSize / emitElementPlacement defaults
+  double s = (e.size == 0.0 ? 1.0 : static_cast<double>(e.size));
+  s = std::max(0.01, std::min(1.0, s));
+  double cx = 0.0, cy = 0.0;
+  if (e.placementCoords.size() >= 2) {
+    cx = std::max(-1.0, std::min(1.0, e.placementCoords[0]));
+    cy = std::max(-1.0, std::min(1.0, e.placementCoords[1]));
+  }
+
+  out += "E{st=" + e.structure;
+  out += ";sz=" + canonicalFixed(s);
+  out += ";pl=" + canonicalFixed(cx) + "," + canonicalFixed(cy);
+  out += ";tx=" + e.texture;
+  out += ";sy=" + e.symmetry;
+  out += ";ly=" + e.layering;
+  out += ";co=" + e.colorUsage;
+  if (!shaderUtility::isBlank(e.elementBehavior)) {
+    out += ";bh=" + e.elementBehavior;
+    out += ";bu=" + e.behaviorUniform;
+    out += ";sp=" + canonicalFixed(e.speed);
+  }
+  out += "}";
+}
+
+inline void appendOptions(std::string &out, const GeneratorOptions &o) {
+  out += "O{opt=" + std::to_string(o.optimize ? 1 : 0);
+  out += ";q=" + std::to_string(o.quality);
+  out += ";ub=" + std::to_string(o.uniformBlock ? 1 : 0);
+  if (o.budgetMs > 0.0) { // without a budget the rest is never read
+    const CostCalibration &c = o.calibration;
+    out += ";ms=" + canonicalGeneral(o.budgetMs);
+    out += ";dg=" + std::to_string(o.downgradeOverBudget ? 1 : 0);
+    out += ";cal=" + canonicalGeneral(c.aluWeight) + "," + canonicalGeneral(c.transcendentalWeight) + "," +
+           canonicalGeneral(c.loopIterationWeight) + "," + canonicalGeneral(c.fixedUnits) + "," +
+           canonicalGeneral(c.pixels) + "," + canonicalGeneral(c.unitsPerMs);
+    // sorted, the unordered_map's order is not stable
+    const std::map<std::string, double> measured(c.measuredHelperUnits.begin(), c.measuredHelperUnits.end());
+    for (const auto &m : measured) out += "," + m.first + ":" + canonicalGeneral(m.second);
+  }
+  out += "}";
+}
+
+} // namespace cache
+
+// canonical text form of a template and the options it is generated with (see
+// top of file)
+inline std::string canonicalTemplate(const ShaderTemplate &tmpl, const GeneratorOptions &options = {}) {
+  std::string out = "v" + std::to_string(kGeneratorVersion) + "|";
+  out += tmpl.hasBackground ? "bg=" + tmpl.backgroundColor : std::string("bg=none");
+  out += "|pal=";
+  for (size_t i = 0; i < tmpl.colorPalette.size(); ++i) {
+    const auto &c = tmpl.colorPalette[i];
+    if (c.size() != 3) continue; // getColorPalette skips these too
+    out += std::to_string(i) + ":" + cache::canonicalGeneral(c[0]) + "," +
+           cache::canonicalGeneral(c[1]) + "," + cache::canonicalGeneral(c[2]) + ";";
+  }
+  out += "|u=";
+  for (const auto &u : tmpl.globalUniforms) out += u + ";";
+  out += "|";
+  for (const auto &e : tmpl.elements) cache::appendElement(out, e);
+  out += "|";
+  cache::appendOptions(out, options);
+  return out;
+}
+
+// stable 64-bit FNV-1a - same value on every platform/run, safe for file names
+inline uint64_t hashCanonical(const std::string &canon) {
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : canon) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+inline uint64_t hashTemplate(const ShaderTemplate &tmpl, const GeneratorOptions &options = {}) {
+  return hashCanonical(canonicalTemplate(tmpl, options));
+}
+
+inline std::string hashToHex(uint64_t h) {
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+  return buf;
+}
+
+/**
+ * @brief LRU of generated GLSL keyed by template hash, optionally backed by a
+ * cache directory that survives restarts. Safe to share between threads.
+ */
+class ShaderCache {
+public:
+  /// @param capacity max shaders kept in memory
+  /// @param cacheDir directory for <hash>.frag / .key files; empty = memory only
+  /// @param options what generate(tmpl) generates with
+  explicit ShaderCache(size_t capacity = 256, std::string cacheDir = "", GeneratorOptions options = {})
+      : mCapacity(capacity == 0 ? 1 : capacity), mDir(std::move(cacheDir)), mOptions(std::move(options)) {
+    if (!mDir.empty()) {
+      std::error_code ec;
+      std::filesystem::create_directories(mDir, ec);
+      if (ec) {
+        std::cerr << "ShaderCache Error: cannot create " << mDir << " ("
+                  << ec.message() << "), running memory only\n";
+        mDir.clear();
+      }
+    }
+  }
+
+  /// GLSL for tmpl - from memory, then disk, then generateShaderCode
+  std::string generate(const ShaderTemplate &tmpl) { return generate(tmpl, mOptions); }
+
+  /// same with other options; they are part of the key, so one cache can hold
+  /// several variants of a template
+  std::string generate(const ShaderTemplate &tmpl, const GeneratorOptions &options) {
+    const std::string canon = canonicalTemplate(tmpl, options);
+    const uint64_t key = hashCanonical(canon);
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mIndex.find(key);
+      if (it != mIndex.end()) {
+        if (it->second->canonical == canon) {
+          mEntries.splice(mEntries.begin(), mEntries, it->second); // mark most recent
+          ++mStats.memoryHits;
+          return it->second->code;
+        }
+        ++mStats.mismatches;
+      }
+    }
+
+    std::string code;
+    if (loadFromDisk(key, canon, code)) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mStats.diskHits;
+      insert(key, canon, code);
+      return code;
+    }
+
+    code = generateShaderCode(tmpl, options);
+    if (!code.empty()) saveToDisk(key, canon, code); // "" = rejected over budget, not cached
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mStats.misses;
+    if (!code.empty()) insert(key, canon, code);
+    return code;
+  }
+
+  struct Stats {
+    size_t memoryHits = 0;
+    size_t diskHits = 0;
+    size_t misses = 0;
+    size_t mismatches = 0; ///< hash found, canonical string differed (collision or stale file)
+  };
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+  }
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+  }
+
+  /// drops the in-memory entries (disk files are left alone)
+  void clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mIndex.clear();
+  }
+
+private:
+  struct Entry {
+    uint64_t key;
+    std::string canonical;
+    std::string code;
+  };
+
+  // caller holds mMutex. a colliding entry under the same key is replaced
+  void insert(uint64_t key, const std::string &canon, const std::string &code) {
+    auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+      mEntries.splice(mEntries.begin(), mEntries, it->second);
+      if (it->second->canonical != canon) { // else another thread got here first
+        it->second->canonical = canon;
+        it->second->code = code;
+      }
+      return;
+    }
+    mEntries.push_front(Entry{key, canon, code});
+    mIndex[key] = mEntries.begin();
+    if (mEntries.size() > mCapacity) {
+      mIndex.erase(mEntries.back().key);
+      mEntries.pop_back();
+    }
+  }
+
+  std::filesystem::path pathFor(uint64_t key, const char *extension) const {
+    return std::filesystem::path(mDir) / (hashToHex(key) + extension);
+  }
+
+  static bool readFile(const std::filesystem::path &path, std::string &text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    text = buffer.str();
+    return true;
+  }
+
+  // a .frag only counts with a .key holding the same canonical string. .key is
+  // written last, so it is read first
+  bool loadFromDisk(uint64_t key, const std::string &canon, std::string &code) {
+    if (mDir.empty()) return false;
+    std::string stored;
+    if (!readFile(pathFor(key, ".key"), stored)) return false;
+    if (stored != canon) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mStats.mismatches;
+      return false;
+    }
+    return readFile(pathFor(key, ".frag"), code) && !code.empty();
+  }
+
+  void saveToDisk(uint64_t key, const std::string &canon, const std::string &code) const {
+    if (mDir.empty()) return;
+    if (writeFile(pathFor(key, ".frag"), code)) writeFile(pathFor(key, ".key"), canon);
+  }
+
+  // write to a temp name then rename so readers never see half a file
+  static bool writeFile(const std::filesystem::path &path, const std::string &text) {
+    std::filesystem::path tmp = path;
+    tmp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+      std::ofstream out(tmp, std::ios::binary);
+      if (!out.is_open()) {
+        std::cerr << "ShaderCache Error: cannot write " << tmp << "\n";
+        return false;
+      }
+      out << text;
+      out.close();
+      if (out.fail()) {
+        std::cerr << "ShaderCache Error: cannot write " << tmp << "\n";
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return false;
+      }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+    return !ec;
+  }
+
+  size_t mCapacity;
+  std::string mDir;
+  GeneratorOptions mOptions;
+  std::list<Entry> mEntries; // front = most recently used
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> mIndex;
+  Stats mStats;
+  mutable std::mutex mMutex;
+};
+
+} // namespace shaderLib
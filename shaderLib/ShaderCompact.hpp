@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+// === Compact templates for planner search === //
+// ShaderElement is seven std::strings, a heap vector for two placement coords
+// and a double; ShaderTemplate adds a vector per palette colour. That's a few
+// hundred bytes and several allocations per element - fine for the generator,
+// a lot when a planner scores millions of candidates. CompactTemplate holds the
+// same information in one trivially copyable block (memcpy, no allocations):
+//   - emitter names as registry ids (the ids the emitters dispatch on)
+//   - anything else that is a string (uniform names, the background colour,
+//     names a registry doesn't know, blanks) interned in a NamePool that all
+//     candidates share
+//   - placement, palette colours, elements and uniforms in fixed-size arrays
+// compactTemplate / expandTemplate convert losslessly both ways. Registry ids
+// are only stable within one build, so don't persist compact templates.
+
+namespace shaderLib {
+
+// interned strings. not thread safe: share one pool per planner thread, or
+// fill it up front
+class NamePool {
+public:
+  /// ids stay under 0x7FFF so kPooled | id never collides; the last one is
+  /// kRefused, handed out (reading back as "") once the pool is full
+  static constexpr size_t kCapacity = 0x7FFF;
+  static constexpr uint16_t kRefused = 0x7FFF;
+
+  /// kRefused for a new name once full - compactTemplate turns that into false
+  uint16_t intern(const std::string &name) {
+    auto it = mIds.find(name);
+    if (it != mIds.end()) return it->second;
+    if (full()) {
+      if (mRefused++ == 0) {
+        std::cerr << "ERROR: NamePool is full (" << kCapacity << " names); refusing \"" << name << "\"" << std::endl;
+      }
+      return kRefused;
+    }
+    const uint16_t id = static_cast<uint16_t>(mNames.size());
+    mNames.push_back(name);
+    mIds.emplace(name, id);
+    return id;
+  }
+
+  const std::string &operator[](uint16_t id) const {
+    static const std::string refused;
+    return id < mNames.size() ? mNames[id] : refused;
+  }
+  size_t size() const { return mNames.size(); }
+  bool full() const { return mNames.size() >= kCapacity; }
+  /// new names turned away so far
+  size_t refused() const { return mRefused; }
+
+private:
+  std::vector<std::string> mNames;
+  std::unordered_map<std::string, uint16_t> mIds;
+  size_t mRefused = 0;
+};
+
+// an emitter name: registry id, or kPooled | NamePool id for anything the
+// registry doesn't know (kept so the round trip is lossless)
+using NameId = uint16_t;
+constexpr NameId kPooled = 0x8000;
+
+struct CompactElement {
+  NameId structure = 0;
+  NameId texture = 0;
+  NameId symmetry = 0;
+  NameId layering = 0;
+  NameId colorUsage = 0;
+  NameId behavior = 0;
+  uint16_t behaviorUniform = 0; ///< NamePool id
+  uint8_t placementCount = 2;   ///< placementCoords.size() (0..2)
+  float size = 1.0f;
+  double placement[2] = {0.0, 0.0};
+  double speed = 1.0;
+};
+
+struct CompactTemplate {
+  static constexpr int kMaxElements = 16;
+  static constexpr int kMaxColors = 8;
+  static constexpr int kMaxColorComponents = 4;
+  static constexpr int kMaxUniforms = 8;
+
+  uint8_t elementCount = 0;
+  uint8_t colorCount = 0;
+  uint8_t uniformCount = 0;
+  bool hasBackground = false;
+  uint16_t backgroundColor = 0;                ///< NamePool id
+  uint16_t uniforms[kMaxUniforms] = {};        ///< NamePool ids
+  uint8_t colorSizes[kMaxColors] = {};         ///< components per colour (3 normally)
+  float colors[kMaxColors][kMaxColorComponents] = {};
+  CompactElement elements[kMaxElements] = {};
+};
+
+static_assert(std::is_trivially_copyable<CompactElement>::value, "CompactElement must stay POD");
+static_assert(std::is_trivially_copyable<CompactTemplate>::value, "CompactTemplate must stay POD");
+
+namespace detail {
+
+template <typename Registry>
+inline NameId encodeName(const Registry &registry, const std::string &name, NamePool &pool) {
+  const int id = registry.id(name);
+  if (id != Registry::kUnknown) return static_cast<NameId>(id);
+  return static_cast<NameId>(kPooled | pool.intern(name));
+}
+
+template <typename Registry>
+inline const char *decodeName(const Registry &registry, NameId id, const NamePool &pool) {
+  if (id & kPooled) return pool[static_cast<uint16_t>(id & ~kPooled)].c_str();
+  return registry[id].name;
+}
+
+} // namespace detail
+
+// false (and an ERROR) when an element carries more than two placement coords,
+// which the compact form can't hold; the extra coords are dropped
+inline bool compactElement(const ShaderElement &element, CompactElement &out, NamePool &pool) {
+  out = CompactElement{};
+  out.structure = detail::encodeName(structures::registry(), element.structure, pool);
+  out.texture = detail::encodeName(textures::registry(), element.texture, pool);
+  out.symmetry = detail::encodeName(symmetry::registry(), element.symmetry, pool);
+  out.layering = detail::encodeName(layering::registry(), element.layering, pool);
+  out.colorUsage = detail::encodeName(color::registry(), element.colorUsage, pool);
+  out.behavior = detail::encodeName(behave::registry(), element.elementBehavior, pool);
+  out.behaviorUniform = pool.intern(element.behaviorUniform);
+  out.size = element.size;
+  out.speed = element.speed;
+
+  const size_t coords = element.placementCoords.size();
+  out.placementCount = static_cast<uint8_t>(std::min<size_t>(coords, 2));
+  for (int i = 0; i < out.placementCount; ++i) out.placement[i] = element.placementCoords[i];
+  if (coords > 2) {
+    std::cerr << "ERROR: placementCoords has " << coords << " values; compact form keeps 2" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+inline ShaderElement expandElement(const CompactElement &element, const NamePool &pool) {
+  ShaderElement out;
+  out.structure = detail::decodeName(structures::registry(), element.structure, pool);
+  out.texture = detail::decodeName(textures::registry(), element.texture, pool);
+  out.symmetry = detail::decodeName(symmetry::registry(), element.symmetry, pool);
+  out.layering = detail::decodeName(layering::registry(), element.layering, pool);
+  out.colorUsage = detail::decodeName(color::registry(), element.colorUsage, pool);
+  out.elementBehavior = detail::decodeName(behave::registry(), element.behavior, pool);
+  out.behaviorUniform = pool[element.behaviorUniform];
+  out.size = element.size;
+  out.speed = element.speed;
+  out.placementCoords.assign(element.placement, element.placement + element.placementCount);
+  return out;
+}
+
+/**
+ * @brief Packs tmpl into out. false (with an ERROR) when tmpl doesn't fit: more
+ * elements / colours / uniforms than the fixed capacities, a colour with more
+ * than four components, more than two placement coords, or a new name when
+ * the NamePool is full; out then holds as much as fits.
+ */
+inline bool compactTemplate(const ShaderTemplate &tmpl, CompactTemplate &out, NamePool &pool) {
+  out = CompactTemplate{};
+  bool ok = true;
+  const size_t refused = pool.refused();
+  auto over = [&](const char *what, size_t count, int cap) {
+    std::cerr << "ERROR: Template has " << count << " " << what << "; compact form holds " << cap << std::endl;
+    ok = false;
+  };
+
+  out.hasBackground = tmpl.hasBackground;
+  out.backgroundColor = pool.intern(tmpl.backgroundColor);
+
+  if (tmpl.globalUniforms.size() > CompactTemplate::kMaxUniforms) {
+    over("uniforms", tmpl.globalUniforms.size(), CompactTemplate::kMaxUniforms);
+  }
+  out.uniformCount = static_cast<uint8_t>(std::min<size_t>(tmpl.globalUniforms.size(), CompactTemplate::kMaxUniforms));
+  for (int i = 0; i < out.uniformCount; ++i) out.uniforms[i] = pool.intern(tmpl.globalUniforms[i]);
+
+  if (tmpl.colorPalette.size() > CompactTemplate::kMaxColors) {
+    over("colors", tmpl.colorPalette.size(), CompactTemplate::kMaxColors);
+  }
+  out.colorCount = static_cast<uint8_t>(std::min<size_t>(tmpl.colorPalette.size(), CompactTemplate::kMaxColors));
+  for (int i = 0; i < out.colorCount; ++i) {
+    const Color &c = tmpl.colorPalette[i];
+    if (c.size() > CompactTemplate::kMaxColorComponents) {
+      over("components in a color", c.size(), CompactTemplate::kMaxColorComponents);
+    }
+    out.colorSizes[i] = static_cast<uint8_t>(std::min<size_t>(c.size(), CompactTemplate::kMaxColorComponents));
+    for (int k = 0; k < out.colorSizes[i]; ++k) out.colors[i][k] = c[k];
+  }
+
+  if (tmpl.elements.size() > CompactTemplate::kMaxElements) {
+    over("elements", tmpl.elements.size(), CompactTemplate::kMaxElements);
+  }
+  out.elementCount = static_cast<uint8_t>(std::min<size_t>(tmpl.elements.size(), CompactTemplate::kMaxElements));
+  for (int i = 0; i < out.elementCount; ++i) {
+    ok = compactElement(tmpl.elements[i], out.elements[i], pool) && ok;
+  }
+  if (pool.refused() != refused) {
+    std::cerr << "ERROR: NamePool is full; names no longer round-trip" << std::endl;
+    ok = false;
+  }
+  return ok;
+}
+
+inline ShaderTemplate expandTemplate(const CompactTemplate &tmpl, const NamePool &pool) {
+  ShaderTemplate out;
+  out.hasBackground = tmpl.hasBackground;
+  out.backgroundColor = pool[tmpl.backgroundColor];
+  out.globalUniforms.reserve(tmpl.uniformCount);
+  for (int i = 0; i < tmpl.uniformCount; ++i) out.globalUniforms.push_back(pool[tmpl.uniforms[i]]);
+  out.colorPalette.reserve(tmpl.colorCount);
+  for (int i = 0; i < tmpl.colorCount; ++i) {
+    out.colorPalette.emplace_back(tmpl.colors[i], tmpl.colors[i] + tmpl.colorSizes[i]);
+  }
+  out.elements.reserve(tmpl.elementCount);
+  for (int i = 0; i < tmpl.elementCount; ++i) out.elements.push_back(expandElement(tmpl.elements[i], pool));
+  return out;
+}
+
+} // namespace shaderLib
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../shaderLib/ShaderIR.hpp"
+#include "../shaderLib/ShaderLibUtility.hpp"
+#include "../shaderLib/emiters/structures.hpp"
+#include "../shaderLib/emiters/textures.hpp"
+
+// === Static cost model === //
+// Estimates per-pixel cost of a built Program without touching the GPU:
+//   - main() statements: one alu per op per vector component, sin/cos count as
+//     transcendental
+//   - helper calls: the hand-counted Cost on each HelperDef (structures.hpp,
+//     fbmTone, blendOverlay) at the shader's QUALITY tier, loops at their
+//     worst-case trip count
+// Cost is turned into "units" with per-class weights, then into milliseconds
+// with a throughput figure for the target machine. Both live in
+// CostCalibration so they can be refit from measurements (ShaderLibJson.hpp
+// reads/writes it) without touching the emitters.
+
+namespace shaderLib {
+
+using shaderUtility::ShaderElement;
+using shaderUtility::ShaderTemplate;
+
+struct CostCalibration {
+  double aluWeight = 1.0;
+  double transcendentalWeight = 4.0; ///< SFU ops run at ~1/4 rate
+  double loopIterationWeight = 2.0;  ///< counter + branch per iteration
+  double fixedUnits = 8.0;            ///< main() setup + fragColor write
+  double pixels = 1920.0 * 1200.0;    ///< per projector frame
+  double unitsPerMs = 4.0e8;          ///< measured throughput of the target GPU
+  /// measured units per call for helpers, by name - replaces the static count
+  std::unordered_map<std::string, double> measuredHelperUnits;
+};
+
+struct CostEstimate {
+  shaderIR::Cost total;
+  std::vector<double> elementUnits; ///< per element, same weights as units
+  double units = 0.0;               ///< per pixel
+  double ms = 0.0;                  ///< per frame at calibration.pixels
+};
+
+inline double costUnits(const shaderIR::Cost &c, const CostCalibration &cal) {
+  return c.alu * cal.aluWeight + c.transcendental * cal.transcendentalWeight +
+         c.loopIterations * cal.loopIterationWeight;
+}
+
+namespace detail {
+
+inline float components(shaderIR::Type t) {
+  switch (t) {
+  case shaderIR::Type::Vec2: return 2.0f;
+  case shaderIR::Type::Vec3: return 3.0f;
+  case shaderIR::Type::Mat2:
+  case shaderIR::Type::Vec4: return 4.0f;
+  default: return 1.0f;
+  }
+}
+
+// cost of an expression tree; measured helper units are added to `extra`
+inline void addExprCost(const shaderIR::Program &p, shaderIR::ExprId id, const CostCalibration &cal,
+                        int quality, shaderIR::Cost &c, double &extra) {
+  using shaderIR::Fn;
+  using shaderIR::Op;
+  const shaderIR::Expr &e = p.exprs[id];
+  switch (e.op) {
+  case Op::Const:
+  case Op::Var:
+  case Op::Uniform:
+  case Op::Palette: return;
+  case Op::Call:
+    switch (e.fn) {
+    case Fn::Helper: {
+      auto it = cal.measuredHelperUnits.find(e.helper->name);
+      if (it != cal.measuredHelperUnits.end()) extra += it->second;
+      else c += e.helper->costAt(quality);
+      break;
+    }
+    case Fn::Sin:
+    case Fn::Cos: c.transcendental += components(e.type); break;
+    case Fn::Smoothstep: c.alu += 4.0f * components(e.type); break;
+    case Fn::Mix: c.alu += 2.0f * components(e.type); break;
+    case Fn::Dot: c.alu += 2.0f * components(p.exprs[e.args[0]].type); break;
+    case Fn::Abs:
+    case Fn::Step: c.alu += components(e.type); break;
+    case Fn::Texture: c.transcendental += 1.0f; break; // one filtered fetch
+
+    default: break; // constructors are free
+    }
+    break;
+  default: c.alu += components(e.type); break;
+  }
+  for (int i = 0; i < e.argc; ++i) addExprCost(p, e.args[i], cal, quality, c, extra);
+}
+
+} // namespace detail
+
+// per-pixel estimate for a built (ideally optimised) Program at a QUALITY tier
+inline CostEstimate estimateCost(const shaderIR::Program &p, int elementCount,
+                                 const CostCalibration &cal = {}, int quality = 2) {
+  CostEstimate est;
+  est.elementUnits.assign(elementCount > 0 ? elementCount : 0, 0.0);
+  double totalExtra = 0.0;
+  for (const shaderIR::Stmt &s : p.stmts) {
+    if (s.op == shaderIR::StmtOp::Comment) continue;
+    shaderIR::Cost c;
+    double extra = 0.0;
+    if (s.op == shaderIR::StmtOp::AddAssign || s.op == shaderIR::StmtOp::MulAssign) {
+      c.alu += detail::components(shaderIR::varType(s.target));
+    }
+    detail::addExprCost(p, s.value, cal, quality, c, extra);
+    if (s.guarded()) { // counted as if it always runs - the budget is worst case
+      c.alu += 1.0f;
+      detail::addExprCost(p, s.guard, cal, quality, c, extra);
+    }
+    est.total += c;
+    totalExtra += extra;
+    if (s.element >= 0 && s.element < elementCount) {
+      est.elementUnits[s.element] += costUnits(c, cal) + extra;
+    }
+  }
+  est.units = costUnits(est.total, cal) + totalExtra + cal.fixedUnits;
+  est.ms = est.units * cal.pixels / cal.unitsPerMs;
+  return est;
+}
+
+// true when some helper in p gets cheaper at a lower QUALITY tier
+inline bool hasQualityTiers(const shaderIR::Program &p) {
+  for (const shaderIR::HelperDef *h : p.helpers) {
+    if (h->hasTiers()) return true;
+  }
+  return false;
+}
+
+// swap the most expensive element that still has a cheaper variant for it
+// (structure first, then texture). false when nothing is left to downgrade
+inline bool downgradeMostExpensive(ShaderTemplate &tmpl, const CostEstimate &est) {
+  std::vector<int> order;
+  for (int i = 0; i < static_cast<int>(tmpl.elements.size()); ++i) order.push_back(i);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    const double ua = a < static_cast<int>(est.elementUnits.size()) ? est.elementUnits[a] : 0.0;
+    const double ub = b < static_cast<int>(est.elementUnits.size()) ? est.elementUnits[b] : 0.0;
+    return ua > ub;
+  });
+
+  for (int i : order) {
+    ShaderElement &e = tmpl.elements[i];
+    const int sid = structures::registry().id(e.structure);
+    if (sid >= 0 && structures::registry()[sid].cheaper) {
+      std::cerr << "WARNING: Element " << i << " over budget; structure " << e.structure
+                << " downgraded to " << structures::registry()[sid].cheaper << std::endl;
+      e.structure = structures::registry()[sid].cheaper;
+      return true;
+    }
+    const int tid = textures::registry().id(e.texture);
+    if (tid >= 0 && textures::registry()[tid].cheaper) {
+      std::cerr << "WARNING: Element " << i << " over budget; texture " << e.texture
+                << " downgraded to " << textures::registry()[tid].cheaper << std::endl;
+      e.texture = textures::registry()[tid].cheaper;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace shaderLib
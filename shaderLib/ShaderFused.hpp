@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../shaderLib/ShaderLibMaster.hpp"
+#include "../shaderLib/ShaderOptimize.hpp"
+
+// === Loop-fused emission === //
+// Planner output often stacks several elements that differ only in where they
+// sit, how big they are, how fast they move and which colours they use (eight
+// circleFields at different positions, ...). Unrolled, each one is its own
+// copy of the structure code with its parameters folded in as literals, and
+// the driver compiles all of them. Here a run of consecutive elements with the
+// same structure / texture / symmetry / layering / behavior is built once, with
+// the parameters that differ read from uniform arrays, and printed as one loop:
+//
+//   uniform vec2 u_fuse2_place[8] = vec2[8](vec2(-0.5, 0.0), ...);
+//   ...
+//   uv = abs(uv);
+//   for (int ei = 0; ei < 8; ++ei) {
+//       vec2 uv_2 = uv - u_fuse2_place[ei];
+//       ...
+//       col = mix(col, layerCol_2, val_2);
+//   }
+//
+// Runs stay in element order, so layering into col is unchanged. Symmetry folds
+// are idempotent and the same for the whole run, so they are applied once in
+// front of the loop. A parameter that is the same for every element of a run
+// is still folded in as a literal. The arrays have initialisers holding the
+// template's values; FusedShader::uniforms lists them too, and
+// ShadedMesh::uniformArray(u) / set(handle, u) send edited values, so an app
+// can move elements around at runtime without recompiling.
+//
+// Segments (single elements and loops) are optimised one at a time, last to
+// first, the same way IncrementalShaderGenerator does it, so a template with
+// no runs of minRun or more prints exactly what generateShaderCode prints
+// (without the budget gate).
+
+namespace shaderLib {
+
+struct FuseOptions {
+  int minRun = 3;       ///< shortest run of same-shape elements worth a loop
+  int quality = 2;      ///< as GeneratorOptions::quality
+  bool optimize = true; ///< as GeneratorOptions::optimize
+  bool uniformBlock = false; ///< as GeneratorOptions::uniformBlock
+};
+
+using shaderUtility::FusedUniform; // ShaderLibUtility.hpp, so ShadedMesh can send it
+
+struct FusedShader {
+  std::string glsl;
+  std::vector<FusedUniform> uniforms;
+  int loops = 0;         ///< fused runs
+  int elementsFused = 0; ///< elements inside those runs
+};
+
+// elements that can share one loop body: everything but placement, size,
+// speed and colour usage has to match
+inline bool sameShape(const ShaderElement &a, const ShaderElement &b) {
+  return a.structure == b.structure && a.texture == b.texture && a.symmetry == b.symmetry &&
+         a.layering == b.layering && a.elementBehavior == b.elementBehavior &&
+         a.behaviorUniform == b.behaviorUniform;
+}
+
+namespace detail {
+
+// GLSL initialiser for an array of `count` values written by `item`
+template <typename Item>
+inline std::string arrayInit(const char *type, int count, Item &&item) {
+  std::string out = type;
+  out += '[';
+  out += std::to_string(count);
+  out += "](";
+  for (int i = 0; i < count; ++i) {
+    if (i) out += ", ";
+    item(out, i);
+  }
+  out += ')';
+  return out;
+}
+
+inline void appendVec(std::string &out, const float *v, int components) {
+  if (components == 1) {
+    shaderIR::appendFloat(out, v[0]);
+    return;
+  }
+  out += "vec";
+  out += std::to_string(components);
+  out += '(';
+  for (int c = 0; c < components; ++c) {
+    if (c) out += ", ";
+    shaderIR::appendFloat(out, v[c]);
+  }
+  out += ')';
+}
+
+// colour pair an element's layerCol mixes between. grayscale is mix(vec3(0),
+// vec3(1), val) == vec3(val), so every usage fits the same mix(). -1 = black/white
+struct ColorPair {
+  int from = -1;
+  int to = -1;
+};
+
+inline ColorPair colorPairOf(const ShaderElement &element) {
+  int id = color::registry().id(element.colorUsage);
+  if (id == shaderUtility::EmitterRegistry<color::ColorEntry>::kUnknown) return {};
+  const color::ColorEntry &entry = color::registry()[id];
+  return entry.from >= 0 ? ColorPair{entry.from, entry.to} : ColorPair{};
+}
+
+/**
+ * @brief Builds a run of same-shape elements [first, first + count) into ir as
+ * one element (index first) whose differing parameters are read from uniform
+ * arrays indexed by the loop counter `ei`. Arrays used are added to uniforms.
+ */
+inline void buildFusedRun(shaderIR::Program &ir, const ShaderTemplate &tmpl, int first, int count,
+                          std::vector<FusedUniform> &uniforms) {
+  using shaderIR::Fn;
+  using shaderIR::Var;
+  const ShaderElement &e = tmpl.elements[first];
+  const std::string prefix = "u_fuse" + std::to_string(first) + "_";
+  auto element = [&](int k) -> const ShaderElement & { return tmpl.elements[first + k]; };
+  auto addArray = [&](const char *what, int components) -> FusedUniform & {
+    uniforms.push_back(FusedUniform{prefix + what, components, count, {}});
+    uniforms.back().values.reserve(static_cast<size_t>(count) * components);
+    return uniforms.back();
+  };
+
+  ir.beginElement(first);
+  const ElementIds ids = resolveElement(e);
+  symmetry::emitElementSymmetry(ir, e, first, ids.symmetry);
+
+  // placement
+  bool samePlace = true;
+  double cx0, cy0;
+  structures::placementOf(e, cx0, cy0);
+  for (int k = 1; k < count && samePlace; ++k) {
+    double cx, cy;
+    structures::placementOf(element(k), cx, cy);
+    samePlace = (cx == cx0 && cy == cy0);
+  }
+  const Var uvi = Var::elementUV(first);
+  if (samePlace) {
+    structures::emitElementPlacement(ir, e, first);
+  } else {
+    FusedUniform &place = addArray("place", 2);
+    for (int k = 0; k < count; ++k) {
+      double cx, cy;
+      structures::placementOf(element(k), cx, cy);
+      place.values.push_back(static_cast<float>(cx));
+      place.values.push_back(static_cast<float>(cy));
+    }
+    const std::string name = place.name + "[ei]";
+    ir.comment({"per-element placement"});
+    ir.declare(uvi, ir.sub(ir.var(Var::uv()), ir.symbol(name, shaderIR::Type::Vec2)));
+  }
+
+  // size - every element's clamp warning still fires
+  std::vector<double> sizes(count);
+  for (int k = 0; k < count; ++k) sizes[k] = structures::sizeOf(element(k), first + k);
+  if (std::all_of(sizes.begin(), sizes.end(), [&](double s) { return s == sizes[0]; })) {
+    if (sizes[0] != 1.0) {
+      ir.comment({"size for element ", std::to_string(first)});
+      ir.assign(uvi, ir.div(ir.var(uvi), ir.constant(sizes[0])));
+    }
+  } else {
+    FusedUniform &size = addArray("size", 1);
+    ir.comment({"per-element size"});
+    for (double s : sizes) size.values.push_back(static_cast<float>(s));
+    ir.assign(uvi, ir.div(ir.var(uvi), ir.symbol(size.name + "[ei]")));
+  }
+
+  // behavior drive speed (only read when the behavior emits anything)
+  std::string speed;
+  const bool driven = !shaderUtility::isBlank(e.elementBehavior) && !shaderUtility::isBlank(e.behaviorUniform) &&
+                      ids.behavior != shaderUtility::EmitterRegistry<behave::BehaviorEntry>::kUnknown;
+  if (driven && !std::all_of(tmpl.elements.begin() + first, tmpl.elements.begin() + first + count,
+                   [&](const ShaderElement &x) { return x.speed == e.speed; })) {
+    FusedUniform &array = addArray("speed", 1);
+    for (int k = 0; k < count; ++k) array.values.push_back(static_cast<float>(element(k).speed));
+    speed = array.name + "[ei]";
+  }
+
+  behave::emitElementBehavior(ir, e, first, behave::BehaviorPhase::UV, ids.behavior, speed);
+  structures::emitElementStructure(ir, e, first, ids.structure);
+  behave::emitElementBehavior(ir, e, first, behave::BehaviorPhase::VAL, ids.behavior, speed);
+  textures::emitElementTexture(ir, e, first, ids.texture);
+
+  // colour
+  std::vector<ColorPair> pairs(count);
+  bool sameColor = true;
+  for (int k = 0; k < count; ++k) {
+    pairs[k] = colorPairOf(element(k));
+    sameColor = sameColor && pairs[k].from == pairs[0].from && pairs[k].to == pairs[0].to;
+  }
+  if (sameColor) {
+    color::emitElementColor(ir, e, first, ids.color);
+  } else {
+    for (int k = 0; k < count; ++k) {
+      if (shaderUtility::isBlank(element(k).colorUsage)) {
+        std::cerr << "ERROR: Element " << first + k << " colorUsage is empty " << std::endl;
+      } else if (color::registry().id(element(k).colorUsage) ==
+                 shaderUtility::EmitterRegistry<color::ColorEntry>::kUnknown) {
+        std::cerr << "ERROR: Inputted colorUsage " << first + k
+                  << " name does not match library" << std::endl;
+      }
+    }
+    // palette colours by value; grayscale runs black -> white
+    auto colorArray = [&](const char *what, int ColorPair::*end, float fallback) {
+      FusedUniform &array = addArray(what, 3);
+      for (const ColorPair &pair : pairs) {
+        const int palette = pair.*end;
+        const bool known = palette >= 0 && palette < static_cast<int>(tmpl.colorPalette.size()) &&
+                           tmpl.colorPalette[palette].size() == 3;
+        for (int c = 0; c < 3; ++c) array.values.push_back(known ? tmpl.colorPalette[palette][c] : fallback);
+      }
+      return ir.symbol(array.name + "[ei]", shaderIR::Type::Vec3);
+    };
+    const shaderIR::ExprId from = colorArray("colorA", &ColorPair::from, 0.0f);
+    const shaderIR::ExprId to = colorArray("colorB", &ColorPair::to, 1.0f);
+    ir.comment({"per-element colours"});
+    ir.declare(Var::layerCol(first), ir.call(Fn::Mix, {from, to, ir.var(Var::val(first))}));
+  }
+
+  layering::emitElementLayering(ir, e, first, ids.layering);
+}
+
+// first statement of a fused body that belongs inside the loop: the leading
+// symmetry folds (uv writes and their comments) are hoisted in front of it
+inline size_t loopStart(const shaderIR::Program &ir) {
+  size_t start = 0;
+  for (size_t i = 0; i < ir.stmts.size(); ++i) {
+    const shaderIR::Stmt &s = ir.stmts[i];
+    if (s.op == shaderIR::StmtOp::Comment) continue;
+    if (s.target.kind != shaderIR::VarKind::UV) break;
+    start = i + 1;
+  }
+  return start;
+}
+
+} // namespace detail
+
+/**
+ * @brief generateShaderCode with runs of minRun or more consecutive same-shape
+ * elements emitted as loops over uniform arrays. Budget options don't apply.
+ */
+inline FusedShader generateFusedShaderCode(const ShaderTemplate &tmpl, const FuseOptions &options = {}) {
+  struct Segment {
+    int first = 0;
+    int count = 1;
+    std::vector<const shaderIR::HelperDef *> helpers;
+    std::string body;
+  };
+
+  FusedShader out;
+  std::vector<Segment> segments;
+  const int elementCount = static_cast<int>(tmpl.elements.size());
+  for (int i = 0; i < elementCount;) {
+    int j = i + 1;
+    while (j < elementCount && sameShape(tmpl.elements[i], tmpl.elements[j])) ++j;
+    if (j - i >= std::max(2, options.minRun)) {
+      segments.push_back(Segment{i, j - i, {}, {}});
+    } else {
+      for (int k = i; k < j; ++k) segments.push_back(Segment{k, 1, {}, {}});
+    }
+    i = j;
+  }
+
+  // last to first: a segment's uv writes only survive when a later one reads uv
+  shaderIR::Program ir;
+  shaderIR::Optimizer optimizer;
+  std::vector<std::vector<FusedUniform>> arrays(segments.size());
+  bool uvLiveOut = false;
+  for (size_t s = segments.size(); s-- > 0;) {
+    Segment &seg = segments[s];
+    ir.clear();
+    if (seg.count == 1) buildElement(ir, tmpl.elements[seg.first], seg.first);
+    else detail::buildFusedRun(ir, tmpl, seg.first, seg.count, arrays[s]);
+    if (options.optimize) {
+      optimizer.run(ir, uvLiveOut);
+      uvLiveOut = optimizer.uvLiveIn();
+    } else {
+      uvLiveOut = true;
+    }
+    seg.helpers = ir.helpers;
+    if (seg.count == 1) {
+      shaderIR::appendStatements(seg.body, ir);
+      continue;
+    }
+
+    const size_t start = detail::loopStart(ir);
+    seg.body += "// elements " + std::to_string(seg.first) + "-" +
+                std::to_string(seg.first + seg.count - 1) + ": " + tmpl.elements[seg.first].structure +
+                " x" + std::to_string(seg.count) + ", one loop\n";
+    shaderIR::appendStatements(seg.body, ir, 0, start);
+    seg.body += "for (int ei = 0; ei < " + std::to_string(seg.count) + "; ++ei) {\n";
+    std::string line;
+    for (size_t i = start; i < ir.stmts.size(); ++i) {
+      line.clear();
+      shaderIR::appendStmt(line, ir, ir.stmts[i]);
+      seg.body += "    ";
+      seg.body += line;
+    }
+    seg.body += "}\n";
+    ++out.loops;
+    out.elementsFused += seg.count;
+  }
+
+  // arrays in element order; ones the optimiser dropped are still declared,
+  // so an app setting them never hits a missing uniform
+  for (std::vector<FusedUniform> &a : arrays) {
+    for (FusedUniform &u : a) out.uniforms.push_back(std::move(u));
+  }
+
+  std::vector<const shaderIR::HelperDef *> helpers;
+  std::string helperText;
+  std::string body;
+  for (const Segment &seg : segments) {
+    for (const shaderIR::HelperDef *h : seg.helpers) {
+      if (std::find(helpers.begin(), helpers.end(), h) != helpers.end()) continue;
+      helpers.push_back(h);
+      shaderIR::appendHelper(helperText, *h);
+    }
+    body += seg.body;
+  }
+
+  appendHeader(out.glsl);
+  appendUniforms(out.glsl, tmpl, options.uniformBlock);
+  appendColorPalette(out.glsl, tmpl);
+  for (const FusedUniform &u : out.uniforms) {
+    const char *type = u.components == 1 ? "float" : u.components == 2 ? "vec2" : "vec3";
+    out.glsl += "uniform ";
+    out.glsl += type;
+    out.glsl += ' ' + u.name + '[' + std::to_string(u.count) + "] = ";
+    out.glsl += detail::arrayInit(type, u.count, [&](std::string &o, int i) {
+      detail::appendVec(o, u.values.data() + static_cast<size_t>(i) * u.components, u.components);
+    });
+    out.glsl += ";\n";
+  }
+  appendQualityDefine(out.glsl, helpers, options.quality);
+  out.glsl += helperText;
+  appendMainBegin(out.glsl);
+  out.glsl += body;
+  appendMainEnd(out.glsl, tmpl);
+  return out;
+}
+
+} // namespace shaderLib
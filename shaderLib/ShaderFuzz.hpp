@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+// === Random valid templates === //
+// For benchmarks and stress runs. Every name is drawn from the emitter
+// registries themselves, so a structure / texture / behavior added to the
+// library is covered without touching this file. Values stay inside the ranges
+// the emitters accept without warnings (size 0.05..1, placement -0.8..0.8, a
+// palette big enough for every colour usage), so generating these shaders
+// should print nothing on stderr.
+
+namespace shaderLib {
+
+struct FuzzOptions {
+  int elements = 8;
+  std::vector<std::string> uniforms = {"u_time", "u_level"}; ///< behaviorUniform is drawn from these
+  double behaviorChance = 0.7; ///< elements without a behavior get "" (the emitters' no-op)
+};
+
+namespace detail {
+
+template <typename Registry>
+inline const char *randomName(const Registry &registry, std::mt19937_64 &rng) {
+  std::uniform_int_distribution<size_t> pick(0, registry.size() - 1);
+  return registry[static_cast<int>(pick(rng))].name;
+}
+
+// palette entries the colour usages reference
+inline int paletteSizeNeeded() {
+  int needed = 0;
+  for (const color::ColorEntry &c : color::registry()) needed = std::max({needed, c.from + 1, c.to + 1});
+  return needed;
+}
+
+} // namespace detail
+
+inline ShaderElement randomElement(std::mt19937_64 &rng, const FuzzOptions &options = {}) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  ShaderElement e;
+  e.structure = detail::randomName(structures::registry(), rng);
+  e.texture = detail::randomName(textures::registry(), rng);
+  e.symmetry = detail::randomName(symmetry::registry(), rng);
+  e.layering = detail::randomName(layering::registry(), rng);
+  e.colorUsage = detail::randomName(color::registry(), rng);
+  e.size = static_cast<float>(0.05 + 0.95 * unit(rng));
+  e.placementCoords = {1.6 * unit(rng) - 0.8, 1.6 * unit(rng) - 0.8};
+  if (unit(rng) < options.behaviorChance && !options.uniforms.empty()) {
+    e.elementBehavior = detail::randomName(behave::registry(), rng);
+    std::uniform_int_distribution<size_t> pick(0, options.uniforms.size() - 1);
+    e.behaviorUniform = options.uniforms[pick(rng)];
+  }
+  e.speed = 0.1 + 2.9 * unit(rng);
+  return e;
+}
+
+inline ShaderTemplate randomTemplate(std::mt19937_64 &rng, const FuzzOptions &options = {}) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  ShaderTemplate tmpl;
+  tmpl.globalUniforms = options.uniforms;
+  const int colors = std::max(3, detail::paletteSizeNeeded());
+  for (int i = 0; i < colors; ++i) tmpl.colorPalette.push_back({unit(rng), unit(rng), unit(rng)});
+  tmpl.hasBackground = unit(rng) < 0.5f;
+  if (tmpl.hasBackground) tmpl.backgroundColor = "(0.02, 0.02, 0.04)";
+  tmpl.elements.reserve(std::max(0, options.elements));
+  for (int i = 0; i < options.elements; ++i) tmpl.elements.push_back(randomElement(rng, options));
+  return tmpl;
+}
+
+} // namespace shaderLib
@@ -0,0 +1,537 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// === Typed IR for the element pipeline === //
+// Emitters describe what an element does to uv / uv_i / val_i / layerCol_i /
+// col as typed expressions and statements in a Program, instead of splicing
+// GLSL strings. The GLSL backend at the bottom of this file prints a Program
+// once at the end, so passes (folding, culling, ...) and other backends can
+// work on the same templates.
+//
+// Everything lives in flat arrays inside the Program and refers to other nodes
+// by index, so expressions form a DAG (a node can be used more than once) and a
+// Program can be clear()ed and refilled without giving memory back.
+//
+// Helper functions (structure fields, fbmTone, blendOverlay) stay as fixed GLSL
+// text - they're library code, not per-template - and are referenced through a
+// HelperDef with static lifetime.
+
+namespace shaderIR {
+
+enum class Type : uint8_t { Float, Vec2, Vec3, Mat2, Vec4 };
+
+inline const char *typeName(Type t) {
+  switch (t) {
+  case Type::Float: return "float";
+  case Type::Vec2:  return "vec2";
+  case Type::Vec3:  return "vec3";
+  case Type::Mat2:  return "mat2";
+  case Type::Vec4:  return "vec4";
+  }
+  return "float";
+}
+
+// === Variables === //
+// the pipeline only touches the shared uv and col, plus each element's own
+// uv_i / val_i / layerCol_i, the rotateUV temporaries a_i / c_i / s_i and
+// bake_i, the one texel fetch a baked layer reads both outputs from
+enum class VarKind : uint8_t { UV, Col, ElementUV, Val, LayerCol, RotAngle, RotCos, RotSin, Baked, Count };
+constexpr int kVarKinds = static_cast<int>(VarKind::Count);
+
+struct Var {
+  VarKind kind = VarKind::UV;
+  int16_t element = -1;  ///< owning element, -1 for the shared uv / col
+  int8_t component = -1; ///< -1 whole variable, 0 = .x, 1 = .y, kRGB / kAlpha of a vec4
+  static constexpr int8_t kRGB = 2;
+  static constexpr int8_t kAlpha = 3;
+
+  static Var uv(int component = -1) { return Var{VarKind::UV, -1, static_cast<int8_t>(component)}; }
+  static Var col() { return Var{VarKind::Col, -1, -1}; }
+  static Var elementUV(int i) { return Var{VarKind::ElementUV, static_cast<int16_t>(i), -1}; }
+  static Var val(int i) { return Var{VarKind::Val, static_cast<int16_t>(i), -1}; }
+  static Var layerCol(int i) { return Var{VarKind::LayerCol, static_cast<int16_t>(i), -1}; }
+  static Var local(VarKind kind, int i) { return Var{kind, static_cast<int16_t>(i), -1}; }
+  static Var baked(int i, int component = -1) {
+    return Var{VarKind::Baked, static_cast<int16_t>(i), static_cast<int8_t>(component)};
+  }
+};
+
+inline Type storageType(VarKind kind) {
+  switch (kind) {
+  case VarKind::UV:
+  case VarKind::ElementUV: return Type::Vec2;
+  case VarKind::Col:
+  case VarKind::LayerCol:  return Type::Vec3;
+  case VarKind::Baked:     return Type::Vec4;
+  default:                 return Type::Float;
+  }
+}
+inline Type varType(const Var &v) {
+  return v.component == Var::kRGB ? Type::Vec3 : v.component >= 0 ? Type::Float : storageType(v.kind);
+}
+
+// one slot per (kind, element) storage location - the layout every pass that
+// keeps per-variable state (optimiser, tracers, CPU renderer) indexes by.
+// varSlotCount: slots for elements up to maxElement, plus the shared uv / col
+inline int varSlot(const Var &v) { return (v.element + 1) * kVarKinds + static_cast<int>(v.kind); }
+inline int varSlotCount(int maxElement) { return (maxElement + 2) * kVarKinds; }
+
+// same storage (uv.x and uv both live in uv)
+inline bool sameStorage(const Var &a, const Var &b) { return a.kind == b.kind && a.element == b.element; }
+inline bool sameVar(const Var &a, const Var &b) { return sameStorage(a, b) && a.component == b.component; }
+
+// === Expressions === //
+using ExprId = uint32_t;
+
+enum class Op : uint8_t { Const, Var, Uniform, Palette, Neg, Add, Sub, Mul, Div, Call };
+
+// builtins the emitters use, plus Helper for library functions
+enum class Fn : uint8_t { Helper, Abs, Sin, Cos, Step, Smoothstep, Mix, Dot, Texture, Vec2, Vec3, Mat2 };
+
+inline const char *fnName(Fn fn) {
+  switch (fn) {
+  case Fn::Helper:     return "";
+  case Fn::Abs:        return "abs";
+  case Fn::Sin:        return "sin";
+  case Fn::Cos:        return "cos";
+  case Fn::Step:       return "step";
+  case Fn::Smoothstep: return "smoothstep";
+  case Fn::Mix:        return "mix";
+  case Fn::Dot:        return "dot";
+  case Fn::Texture:    return "texture";
+  case Fn::Vec2:       return "vec2";
+  case Fn::Vec3:       return "vec3";
+  case Fn::Mat2:       return "mat2";
+  }
+  return "";
+}
+
+// static per-pixel cost of running something once (see ShaderCost.hpp).
+// loop bodies are counted at their worst-case trip count
+struct Cost {
+  float alu = 0.0f;            ///< add/mul/compare/fract/... per component
+  float transcendental = 0.0f; ///< sin/cos/atan/pow/sqrt/length
+  float loopIterations = 0.0f; ///< total iterations of any loops
+
+  Cost &operator+=(const Cost &o) {
+    alu += o.alu;
+    transcendental += o.transcendental;
+    loopIterations += o.loopIterations;
+    return *this;
+  }
+};
+
+// a library GLSL function, printed as  preamble + "<returns> <name>" + body
+struct HelperDef {
+  const char *name;
+  const char *preamble; ///< comment + any shared helpers the function needs
+  const char *body;     ///< "(vec2 p) { ... }" - everything after the name
+  Type returns = Type::Float;
+  Cost cost = {};       ///< per call, estimated by hand from body
+  Cost lowerTiers[2] = {}; ///< cost at QUALITY 0 / 1; all zero = no LOD variants
+
+  // helper has reduced-cost variants selected by the QUALITY define
+  bool hasTiers() const { return lowerTiers[0].alu > 0.0f || lowerTiers[1].alu > 0.0f; }
+  const Cost &costAt(int quality) const {
+    return (quality >= 2 || !hasTiers()) ? cost : lowerTiers[quality < 0 ? 0 : quality];
+  }
+};
+
+struct Symbol {
+  uint32_t offset = 0;
+  uint32_t length = 0;
+};
+
+struct Expr {
+  Op op = Op::Const;
+  Type type = Type::Float;
+  Fn fn = Fn::Helper;      ///< Call
+  uint8_t argc = 0;        ///< Call / Neg / binary ops
+  double value = 0.0;      ///< Const
+  Var var;                 ///< Var
+  Symbol symbol;           ///< Uniform name (or a #define / shader input), Texture sampler
+  int palette = 0;         ///< Palette -> color<palette>
+  const HelperDef *helper = nullptr; ///< Call with Fn::Helper
+  ExprId args[4] = {0, 0, 0, 0};
+};
+
+// === Statements === //
+enum class StmtOp : uint8_t { Declare, Assign, AddAssign, MulAssign, Comment };
+
+constexpr ExprId kNoGuard = 0xFFFFFFFFu;
+
+struct Stmt {
+  StmtOp op = StmtOp::Comment;
+  int16_t element = -1; ///< element that emitted it
+  Var target;           ///< everything but Comment
+  ExprId value = 0;     ///< everything but Comment
+  Symbol text;          ///< Comment, without the leading "// "
+  ExprId guard = kNoGuard; ///< Assign only runs where guard < guardBelow (footprint culling)
+  double guardBelow = 0.0;
+
+  bool guarded() const { return guard != kNoGuard; }
+};
+
+/**
+ * @brief One shader's element pipeline: statements in main() order plus the
+ * helper functions they call. Emitters append through the builder methods.
+ */
+class Program {
+public:
+  std::vector<Expr> exprs;
+  std::vector<Stmt> stmts;
+  std::vector<const HelperDef *> helpers; ///< in first-use order, each once
+  std::string pool;                       ///< uniform names + comment text
+
+  // keeps capacity so a Program can be reused across templates
+  void clear() {
+    exprs.clear();
+    stmts.clear();
+    helpers.clear();
+    pool.clear();
+    mElement = -1;
+  }
+
+  // statements added after this are tagged with the element index
+  void beginElement(int elementIndex) { mElement = static_cast<int16_t>(elementIndex); }
+  int currentElement() const { return mElement; }
+
+  Symbol intern(std::string_view s) {
+    Symbol sym{static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(s.size())};
+    pool.append(s.data(), s.size());
+    return sym;
+  }
+  std::string_view text(Symbol s) const { return std::string_view(pool).substr(s.offset, s.length); }
+
+  // --- expressions ---
+  ExprId constant(double v) {
+    Expr e;
+    e.op = Op::Const;
+    e.value = v;
+    return push(e);
+  }
+  ExprId var(const Var &v) {
+    Expr e;
+    e.op = Op::Var;
+    e.var = v;
+    e.type = varType(v);
+    return push(e);
+  }
+  ExprId uniform(std::string_view name) {
+    Expr e;
+    e.op = Op::Uniform;
+    e.symbol = intern(name);
+    return push(e);
+  }
+  // a float the helpers #define (e.g. JULIA_OUTSIDE) or a shader input
+  // (vPos.xy) - printed by name like a uniform, opaque to the optimiser
+  ExprId symbol(std::string_view name, Type type = Type::Float) {
+    const ExprId id = uniform(name);
+    exprs[id].type = type;
+    return id;
+  }
+  ExprId palette(int index) {
+    Expr e;
+    e.op = Op::Palette;
+    e.palette = index;
+    e.type = Type::Vec3;
+    return push(e);
+  }
+  ExprId neg(ExprId a) {
+    Expr e;
+    e.op = Op::Neg;
+    e.argc = 1;
+    e.args[0] = a;
+    e.type = exprs[a].type;
+    return push(e);
+  }
+  ExprId add(ExprId a, ExprId b) { return binary(Op::Add, a, b); }
+  ExprId sub(ExprId a, ExprId b) { return binary(Op::Sub, a, b); }
+  ExprId mul(ExprId a, ExprId b) { return binary(Op::Mul, a, b); }
+  ExprId div(ExprId a, ExprId b) { return binary(Op::Div, a, b); }
+
+  ExprId call(Fn fn, std::initializer_list<ExprId> args) {
+    Expr e;
+    e.op = Op::Call;
+    e.fn = fn;
+    for (ExprId a : args) e.args[e.argc++] = a;
+    e.type = callType(fn, e);
+    return push(e);
+  }
+  ExprId call(const HelperDef &helper, std::initializer_list<ExprId> args) {
+    useHelper(helper);
+    Expr e;
+    e.op = Op::Call;
+    e.fn = Fn::Helper;
+    e.helper = &helper;
+    for (ExprId a : args) e.args[e.argc++] = a;
+    e.type = helper.returns;
+    return push(e);
+  }
+
+  // texture(sampler, coord): the whole texel for a Vec4, .rgb for a Vec3, .a
+  // for a Float (baked layers, ShaderBake.hpp)
+  ExprId sample(std::string_view sampler, ExprId coord, Type type) {
+    Expr e;
+    e.op = Op::Call;
+    e.fn = Fn::Texture;
+    e.symbol = intern(sampler);
+    e.argc = 1;
+    e.args[0] = coord;
+    e.type = type;
+    return push(e);
+  }
+
+  // --- statements ---
+  void declare(const Var &v, ExprId value) { pushStmt(StmtOp::Declare, v, value); }
+  void assign(const Var &v, ExprId value) { pushStmt(StmtOp::Assign, v, value); }
+  void addAssign(const Var &v, ExprId value) { pushStmt(StmtOp::AddAssign, v, value); }
+  void mulAssign(const Var &v, ExprId value) { pushStmt(StmtOp::MulAssign, v, value); }
+  // if (guard < below) v = value;  - v keeps its previous value elsewhere
+  void assignIf(ExprId guard, double below, const Var &v, ExprId value) {
+    pushStmt(StmtOp::Assign, v, value);
+    stmts.back().guard = guard;
+    stmts.back().guardBelow = below;
+  }
+
+  // pieces are concatenated, "// " is added by the printer
+  void comment(std::initializer_list<std::string_view> pieces) {
+    Stmt s;
+    s.op = StmtOp::Comment;
+    s.element = mElement;
+    s.text.offset = static_cast<uint32_t>(pool.size());
+    for (std::string_view p : pieces) pool.append(p.data(), p.size());
+    s.text.length = static_cast<uint32_t>(pool.size()) - s.text.offset;
+    stmts.push_back(s);
+  }
+
+  void useHelper(const HelperDef &helper) {
+    for (const HelperDef *h : helpers) {
+      if (h == &helper) return;
+    }
+    helpers.push_back(&helper);
+  }
+
+private:
+  ExprId push(const Expr &e) {
+    exprs.push_back(e);
+    return static_cast<ExprId>(exprs.size() - 1);
+  }
+
+  ExprId binary(Op op, ExprId a, ExprId b) {
+    Expr e;
+    e.op = op;
+    e.argc = 2;
+    e.args[0] = a;
+    e.args[1] = b;
+    const Type ta = exprs[a].type, tb = exprs[b].type;
+    if (ta == Type::Mat2 && tb == Type::Vec2) e.type = Type::Vec2;
+    else if (ta == Type::Float) e.type = tb;
+    else e.type = ta;
+    return push(e);
+  }
+
+  Type callType(Fn fn, const Expr &e) const {
+    switch (fn) {
+    case Fn::Vec2: return Type::Vec2;
+    case Fn::Vec3: return Type::Vec3;
+    case Fn::Mat2: return Type::Mat2;
+    case Fn::Mix:  return exprs[e.args[0]].type;
+    case Fn::Dot:  return Type::Float;
+    case Fn::Step:
+    case Fn::Smoothstep: return exprs[e.args[e.argc - 1]].type; // genType x
+    default: return e.argc ? exprs[e.args[0]].type : Type::Float;
+    }
+  }
+
+  void pushStmt(StmtOp op, const Var &v, ExprId value) {
+    Stmt s;
+    s.op = op;
+    s.element = mElement;
+    s.target = v;
+    s.value = value;
+    stmts.push_back(s);
+  }
+
+  int16_t mElement = -1;
+};
+
+// === GLSL backend === //
+
+// shortest fixed form: 2.0, 0.35, -0.1, 6.28318 (6 decimals max, like the old
+// std::to_string / glslFloat output but without the trailing zeros). written
+// into buf, so callers building comment pieces don't need a std::string
+inline std::string_view formatFloat(char (&buf)[64], double x) {
+  std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf) - 1, x, std::chars_format::fixed, 6);
+  if (r.ec != std::errc()) { // |x| too big for fixed - never a sensible shader literal anyway
+    r = std::to_chars(buf, buf + sizeof(buf) - 1, x, std::chars_format::general, 6);
+  }
+  int n = static_cast<int>(r.ptr - buf);
+  if (std::memchr(buf, '.', static_cast<size_t>(n)) && !std::memchr(buf, 'e', static_cast<size_t>(n))) {
+    while (n > 0 && buf[n - 1] == '0') --n;
+    if (n > 0 && buf[n - 1] == '.') buf[n++] = '0';
+  }
+  if (n == 4 && buf[0] == '-' && buf[1] == '0' && buf[3] == '0') return "0.0"; // "-0.0"
+  return std::string_view(buf, static_cast<size_t>(n));
+}
+
+inline void appendFloat(std::string &out, double x) {
+  char buf[64];
+  out += formatFloat(buf, x);
+}
+
+// decimal i into buf (element indices in comments, #define values)
+inline std::string_view formatInt(char (&buf)[16], int i) {
+  const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), i);
+  return std::string_view(buf, static_cast<size_t>(r.ptr - buf));
+}
+
+inline void appendInt(std::string &out, int i) {
+  char buf[16];
+  out += formatInt(buf, i);
+}
+
+inline void appendVarName(std::string &out, const Var &v) {
+  switch (v.kind) {
+  case VarKind::UV:        out += "uv"; break;
+  case VarKind::Col:       out += "col"; break;
+  case VarKind::ElementUV: out += "uv_"; break;
+  case VarKind::Val:       out += "val_"; break;
+  case VarKind::LayerCol:  out += "layerCol_"; break;
+  case VarKind::RotAngle:  out += "a_"; break;
+  case VarKind::RotCos:    out += "c_"; break;
+  case VarKind::RotSin:    out += "s_"; break;
+  case VarKind::Baked:     out += "bake_"; break;
+  case VarKind::Count:     break;
+  }
+  if (v.element >= 0) appendInt(out, v.element);
+  if (v.component == 0) out += ".x";
+  else if (v.component == 1) out += ".y";
+  else if (v.component == Var::kRGB) out += ".rgb";
+  else if (v.component == Var::kAlpha) out += ".a";
+}
+
+namespace detail {
+
+// binding strength: + - 1, * / 2, unary minus 3, everything else 4
+inline int precedence(const Expr &e) {
+  switch (e.op) {
+  case Op::Add:
+  case Op::Sub: return 1;
+  case Op::Mul:
+  case Op::Div: return 2;
+  case Op::Neg: return 3;
+  case Op::Const: return e.value < 0.0 ? 3 : 4;
+  default: return 4;
+  }
+}
+
+inline void appendExpr(std::string &out, const Program &p, ExprId id, int minPrecedence) {
+  const Expr &e = p.exprs[id];
+  const int prec = precedence(e);
+  const bool parens = prec < minPrecedence;
+  if (parens) out += '(';
+
+  switch (e.op) {
+  case Op::Const: appendFloat(out, e.value); break;
+  case Op::Var: appendVarName(out, e.var); break;
+  case Op::Uniform: out += p.text(e.symbol); break;
+  case Op::Palette:
+    out += "color";
+    appendInt(out, e.palette);
+    break;
+  case Op::Neg: // operand at 4: another minus (-x, -1.0) gets parens, not "--"
+    out += '-';
+    appendExpr(out, p, e.args[0], 4);
+    break;
+  case Op::Add:
+  case Op::Sub:
+  case Op::Mul:
+  case Op::Div: {
+    static const char *ops[] = {" + ", " - ", " * ", " / "};
+    appendExpr(out, p, e.args[0], prec);
+    out += ops[static_cast<int>(e.op) - static_cast<int>(Op::Add)];
+    appendExpr(out, p, e.args[1], prec + 1); // keep right-nested grouping
+    break;
+  }
+  case Op::Call:
+    if (e.fn == Fn::Texture) {
+      out += "texture(";
+      out += p.text(e.symbol);
+      out += ", ";
+      appendExpr(out, p, e.args[0], 0);
+      out += e.type == Type::Vec4 ? ")" : e.type == Type::Vec3 ? ").rgb" : ").a";
+      break;
+    }
+    out += (e.fn == Fn::Helper) ? e.helper->name : fnName(e.fn);
+    out += '(';
+    for (int i = 0; i < e.argc; ++i) {
+      if (i) out += ", ";
+      appendExpr(out, p, e.args[i], 0);
+    }
+    out += ')';
+    break;
+  }
+
+  if (parens) out += ')';
+}
+
+} // namespace detail
+
+inline void appendExpr(std::string &out, const Program &p, ExprId id) { detail::appendExpr(out, p, id, 0); }
+
+inline void appendStmt(std::string &out, const Program &p, const Stmt &s) {
+  if (s.op == StmtOp::Comment) {
+    out += "// ";
+    out += p.text(s.text);
+    out += '\n';
+    return;
+  }
+  if (s.guarded()) {
+    out += "if (";
+    appendExpr(out, p, s.guard);
+    out += " < ";
+    appendFloat(out, s.guardBelow);
+    out += ") ";
+  }
+  if (s.op == StmtOp::Declare) {
+    out += typeName(storageType(s.target.kind));
+    out += ' ';
+  }
+  appendVarName(out, s.target);
+  switch (s.op) {
+  case StmtOp::AddAssign: out += " += "; break;
+  case StmtOp::MulAssign: out += " *= "; break;
+  default: out += " = "; break;
+  }
+  appendExpr(out, p, s.value);
+  out += ";\n";
+}
+
+// statements in [begin, end) - lines to paste inside main()
+inline void appendStatements(std::string &out, const Program &p, size_t begin, size_t end) {
+  for (size_t i = begin; i < end && i < p.stmts.size(); ++i) appendStmt(out, p, p.stmts[i]);
+}
+inline void appendStatements(std::string &out, const Program &p) { appendStatements(out, p, 0, p.stmts.size()); }
+
+inline void appendHelper(std::string &out, const HelperDef &h) {
+  out += h.preamble;
+  out += typeName(h.returns);
+  out += ' ';
+  out += h.name;
+  out += h.body;
+}
+
+// top-level helper functions, each once
+inline void appendHelpers(std::string &out, const Program &p) {
+  for (const HelperDef *h : p.helpers) appendHelper(out, *h);
+}
+
+} // namespace shaderIR
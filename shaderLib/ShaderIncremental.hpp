@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../shaderLib/ShaderLibMaster.hpp"
+#include "../shaderLib/ShaderOptimize.hpp"
+
+// === Incremental regeneration for the live editor === //
+// Keeps the printed GLSL of every element from the last generate() call, keyed
+// on (element fields, index, whether a later element reads uv). On the next
+// call only elements whose key changed are rebuilt/optimised/printed; the rest,
+// and the header/uniforms/palette block, are pasted back from the previous run.
+// Keys are compared field by field against a stored copy of the element -
+// building canonical strings (ShaderCache.hpp) for every element on every
+// keystroke cost more than re-emitting the one that changed.
+// Output is byte-identical to generateShaderCode with the same options (the
+// budget gate is not applied here).
+//
+// Elements are processed last to first: an element's uv writes are only kept
+// when a later element reads uv, so each slot needs to know that before it can
+// be optimised.
+
+namespace shaderLib {
+
+class IncrementalShaderGenerator {
+public:
+  struct Stats {
+    size_t elementsEmitted = 0; ///< rebuilt on the last generate()
+    size_t elementsReused = 0;  ///< pasted from the previous run
+    bool prologueReused = false;
+  };
+
+  explicit IncrementalShaderGenerator(GeneratorOptions options = {}) : mOptions(options) {}
+
+  /// GLSL for tmpl; the reference stays valid until the next call
+  const std::string &generate(const ShaderTemplate &tmpl) {
+    mStats = Stats{};
+    updatePrologue(tmpl);
+
+    const int count = static_cast<int>(tmpl.elements.size());
+    mSlots.resize(count);
+    bool uvLiveOut = false;
+    for (int i = count - 1; i >= 0; --i) {
+      updateSlot(mSlots[i], tmpl.elements[i], i, uvLiveOut);
+      uvLiveOut = mSlots[i].uvLiveIn;
+    }
+
+    // helpers in first-use order across elements, each once
+    mHelpers.clear();
+    std::string body;
+    std::string helpers;
+    for (const Slot &slot : mSlots) {
+      for (const shaderIR::HelperDef *h : slot.helpers) {
+        if (std::find(mHelpers.begin(), mHelpers.end(), h) != mHelpers.end()) continue;
+        mHelpers.push_back(h);
+        shaderIR::appendHelper(helpers, *h);
+      }
+      body += slot.body;
+    }
+
+    mCode = mPrologue;
+    appendQualityDefine(mCode, mHelpers, mOptions.quality);
+    mCode += helpers;
+    appendMainBegin(mCode);
+    mCode += body;
+    appendMainEnd(mCode, tmpl);
+    return mCode;
+  }
+
+  const Stats &stats() const { return mStats; }
+
+  // forget everything (e.g. after the emitter library changed)
+  void clear() {
+    mSlots.clear();
+    mPalette.clear();
+    mUniforms.clear();
+    mPrologue.clear();
+    mCode.clear();
+  }
+
+private:
+  struct Slot {
+    bool valid = false;
+    ShaderElement element; ///< what body was built from
+    bool uvLiveOut = false;
+    bool uvLiveIn = false;
+    std::vector<const shaderIR::HelperDef *> helpers;
+    std::string body; ///< main() lines
+  };
+
+  // anything the emitters read. stricter than the canonical form (speed with no
+  // behavior still counts), which only costs a rebuild
+  static bool sameElement(const ShaderElement &a, const ShaderElement &b) {
+    return a.structure == b.structure && a.size == b.size &&
+           a.placementCoords == b.placementCoords && a.texture == b.texture &&
+           a.symmetry == b.symmetry && a.layering == b.layering &&
+           a.colorUsage == b.colorUsage && a.elementBehavior == b.elementBehavior &&
+           a.behaviorUniform == b.behaviorUniform && a.speed == b.speed;
+  }
+
+  void updatePrologue(const ShaderTemplate &tmpl) {
+    if (!mPrologue.empty() && tmpl.colorPalette == mPalette && tmpl.globalUniforms == mUniforms) {
+      mStats.prologueReused = true;
+      return;
+    }
+    mPalette = tmpl.colorPalette;
+    mUniforms = tmpl.globalUniforms;
+    mPrologue.clear();
+    appendHeader(mPrologue);
+    appendUniforms(mPrologue, tmpl, mOptions.uniformBlock);
+    appendColorPalette(mPrologue, tmpl);
+  }
+
+  void updateSlot(Slot &slot, const ShaderElement &element, int index, bool uvLiveOut) {
+    // slots are per index, so the index is part of the key already
+    if (slot.valid && uvLiveOut == slot.uvLiveOut && sameElement(element, slot.element)) {
+      ++mStats.elementsReused;
+      return;
+    }
+    ++mStats.elementsEmitted;
+
+    mIR.clear();
+    buildElement(mIR, element, index);
+    if (mOptions.optimize) {
+      mOptimizer.run(mIR, uvLiveOut);
+      slot.uvLiveIn = mOptimizer.uvLiveIn();
+    } else {
+      slot.uvLiveIn = true; // unoptimised output never drops uv writes
+    }
+    slot.valid = true;
+    slot.element = element;
+    slot.uvLiveOut = uvLiveOut;
+    slot.helpers = mIR.helpers;
+    slot.body.clear();
+    shaderIR::appendStatements(slot.body, mIR);
+  }
+
+  GeneratorOptions mOptions;
+  std::vector<Slot> mSlots;
+  shaderUtility::ColorPalette mPalette;
+  std::vector<std::string> mUniforms;
+  std::string mPrologue; ///< header + uniforms + palette
+  std::string mCode;
+  std::vector<const shaderIR::HelperDef *> mHelpers;
+  shaderIR::Program mIR;
+  shaderIR::Optimizer mOptimizer;
+  Stats mStats;
+};
+
+} // namespace shaderLib
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../agent/third_party/nlohmann/json.hpp"
+#include "../shaderLib/ShaderCost.hpp"
+#include "../shaderLib/ShaderLibUtility.hpp"
+
+// JSON <-> ShaderTemplate. Field names match the struct members one to one, so
+// a record looks like:
+//
+//   {"name": "gold_mandala", "hasBackground": true,
+//    "backgroundColor": "(0.02, 0.02, 0.04)",
+//    "colorPalette": [[0.95, 0.85, 0.2], [0.1, 0.55, 0.95], [0.98, 0.2, 0.35]],
+//    "globalUniforms": ["u_time"],
+//    "elements": [{"structure": "mandalaRadial", "size": 0.72,
+//                  "placementCoords": [0.0, 0.0], "texture": "fbm",
+//                  "symmetry": "both", "layering": "overlay",
+//                  "colorUsage": "secondary", "elementBehavior": "sineMod",
+//                  "behaviorUniform": "u_time", "speed": 1.1}]}
+//
+// Missing fields keep the struct defaults. "name" is not part of the template;
+// tools use it for output file names. Malformed records throw nlohmann::json
+// exceptions - callers decide whether that's fatal.
+
+namespace shaderUtility {
+
+inline void to_json(nlohmann::json &j, const ShaderElement &e) {
+  j = nlohmann::json{{"structure", e.structure},
+                     {"size", e.size},
+                     {"placementCoords", e.placementCoords},
+                     {"texture", e.texture},
+                     {"symmetry", e.symmetry},
+                     {"layering", e.layering},
+                     {"colorUsage", e.colorUsage},
+                     {"elementBehavior", e.elementBehavior},
+                     {"behaviorUniform", e.behaviorUniform},
+                     {"speed", e.speed}};
+}
+
+inline void from_json(const nlohmann::json &j, ShaderElement &e) {
+  e.structure = j.value("structure", e.structure);
+  e.size = j.value("size", e.size);
+  e.placementCoords = j.value("placementCoords", e.placementCoords);
+  e.texture = j.value("texture", e.texture);
+  e.symmetry = j.value("symmetry", e.symmetry);
+  e.layering = j.value("layering", e.layering);
+  e.colorUsage = j.value("colorUsage", e.colorUsage);
+  e.elementBehavior = j.value("elementBehavior", e.elementBehavior);
+  e.behaviorUniform = j.value("behaviorUniform", e.behaviorUniform);
+  e.speed = j.value("speed", e.speed);
+}
+
+inline void to_json(nlohmann::json &j, const ShaderTemplate &t) {
+  j = nlohmann::json{{"hasBackground", t.hasBackground},
+                     {"backgroundColor", t.backgroundColor},
+                     {"colorPalette", t.colorPalette},
+                     {"globalUniforms", t.globalUniforms},
+                     {"elements", t.elements}};
+}
+
+inline void from_json(const nlohmann::json &j, ShaderTemplate &t) {
+  t.hasBackground = j.value("hasBackground", false);
+  t.backgroundColor = j.value("backgroundColor", t.backgroundColor);
+  t.colorPalette = j.value("colorPalette", t.colorPalette);
+  t.globalUniforms = j.value("globalUniforms", t.globalUniforms);
+  t.elements = j.value("elements", t.elements);
+}
+
+} // namespace shaderUtility
+
+// cost model calibration (ShaderCost.hpp), e.g.
+//   {"transcendentalWeight": 6.0, "unitsPerMs": 2.5e8,
+//    "measuredHelperUnits": {"julia": 900.0}}
+namespace shaderLib {
+
+inline void to_json(nlohmann::json &j, const CostCalibration &c) {
+  j = nlohmann::json{{"aluWeight", c.aluWeight},
+                     {"transcendentalWeight", c.transcendentalWeight},
+                     {"loopIterationWeight", c.loopIterationWeight},
+                     {"fixedUnits", c.fixedUnits},
+                     {"pixels", c.pixels},
+                     {"unitsPerMs", c.unitsPerMs},
+                     {"measuredHelperUnits", c.measuredHelperUnits}};
+}
+
+inline void from_json(const nlohmann::json &j, CostCalibration &c) {
+  c.aluWeight = j.value("aluWeight", c.aluWeight);
+  c.transcendentalWeight = j.value("transcendentalWeight", c.transcendentalWeight);
+  c.loopIterationWeight = j.value("loopIterationWeight", c.loopIterationWeight);
+  c.fixedUnits = j.value("fixedUnits", c.fixedUnits);
+  c.pixels = j.value("pixels", c.pixels);
+  c.unitsPerMs = j.value("unitsPerMs", c.unitsPerMs);
+  c.measuredHelperUnits = j.value("measuredHelperUnits", c.measuredHelperUnits);
+}
+
+} // namespace shaderLib
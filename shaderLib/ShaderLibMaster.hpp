@@ -2,10 +2,12 @@
 #include <stdlib.h>
 #include <string>
 
+#include <charconv>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "../shaderLib/emiters/structures.hpp"
@@ -14,7 +16,10 @@
 #include "../shaderLib/emiters/color.hpp"
 #include "../shaderLib/emiters/layering.hpp"
 #include "../shaderLib/emiters/behave.hpp"
-#include "../shaderLib/shaderLibUtility.hpp"
+#include "../shaderLib/ShaderLibUtility.hpp"
+#include "../shaderLib/ShaderIR.hpp"
+#include "../shaderLib/ShaderOptimize.hpp"
+#include "../shaderLib/ShaderCost.hpp"
 //#include "shader-env/shaderLib/S.hpp"
 
 //
@@ -29,6 +34,22 @@ using shaderUtility::ColorPalette;
 using shaderUtility::ShaderElement;  
 using shaderUtility::ShaderTemplate;
 using shaderUtility::Emitted;        
+using shaderUtility::FrameBlock;
+using shaderUtility::kFrameBlockMembers;
+
+// bump whenever the GLSL an unchanged template produces changes, so anything
+// cached by ShaderCache (in memory or on disk) gets regenerated
+constexpr int kGeneratorVersion = 6;
+
+// knobs for generateShaderCode. ShaderCache keys its entries on them too
+struct GeneratorOptions {
+  bool optimize = true; ///< fold constants + drop dead code before printing (ShaderOptimize.hpp)
+  int quality = 2; ///< QUALITY tier for structures with LOD variants: 0 low, 1 medium, 2 full
+  double budgetMs = 0.0; ///< > 0: cap on estimated frame time (ShaderCost.hpp)
+  bool downgradeOverBudget = true; ///< lower quality, then swap in cheaper structures/textures; false rejects
+  bool uniformBlock = false; ///< declare the FrameUniforms std140 block instead of loose u_time/onset/... uniforms
+  CostCalibration calibration;
+};
 
 // INDIVIDUAL ELEMENT STRUCTURE CONTAINS THE FOLLOWING COMPONENTS. the elements
 // are appended to a vector of elements. this vector is looped through, adding
@@ -45,10 +66,15 @@ using shaderUtility::Emitted;
 // using behave::emitElementBehavior;
 
 
+// the shader is written through append* functions into one caller-owned
+// buffer (a "sink"); the get* versions wrap them for one-off use. floats go
+// through std::to_chars, never a stream, so a reused buffer makes generation
+// allocation free (see ShaderGenerator below)
+
 // HEADER OF STANDARD MATH and begining of allolib compatible glsl files-
 // POPULATE MORE //
-std::string getHeader() {
-  return R"GLSL(#version 330 core
+inline void appendHeader(std::string &out) {
+  out += R"GLSL(#version 330 core
 
 in vec3 vPos;
 in vec2 vUV;
@@ -59,105 +85,308 @@ out vec4 fragColor;
 const mat2 rot = mat2(0.5, 0.86, -0.86, 0.5);
 )GLSL";
 }
+std::string getHeader() {
+  std::string out;
+  appendHeader(out);
+  return out;
+}
 
 
-// dynamically takes uniforms inputted from template
-std::string getUniforms(const ShaderTemplate &tmpl) {
-  std::ostringstream out;
+inline bool isFrameBlockMember(const std::string &name) {
+  for (const char *m : kFrameBlockMembers) {
+    if (name == m) return true;
+  }
+  return false;
+}
+
+// dynamically takes uniforms inputted from template. with uniformBlock the
+// per-frame ones come from the shared FrameUniforms block (declared whole,
+// whichever members the template uses, so every program has the same layout)
+// and only the rest stay loose uniforms
+inline void appendUniforms(std::string &out, const ShaderTemplate &tmpl, bool uniformBlock = false) {
+  if (uniformBlock) {
+    out += "layout(std140) uniform ";
+    out += shaderUtility::kFrameBlockName;
+    out += " {\n";
+    for (const char *m : kFrameBlockMembers) {
+      out += "  float ";
+      out += m;
+      out += ";\n";
+    }
+    out += "};\n";
+  }
   for (const auto &u : tmpl.globalUniforms) {
-    out << "uniform float " << u << ";\n";
+    if (uniformBlock && isFrameBlockMember(u)) continue;
+    out += "uniform float ";
+    out += u;
+    out += ";\n";
   }
-  return out.str();
 }
-std::string getColorPalette(const ShaderTemplate &tmpl) {
-    std::ostringstream out;
+std::string getUniforms(const ShaderTemplate &tmpl, bool uniformBlock = false) {
+  std::string out;
+  appendUniforms(out, tmpl, uniformBlock);
+  return out;
+}
 
+// palette components print the way an ostream prints a float (%g, 6 digits)
+inline void appendColorPalette(std::string &out, const ShaderTemplate &tmpl) {
+    char buf[32];
     for (int i = 0; i < static_cast<int>(tmpl.colorPalette.size()); ++i) {
         const auto &c = tmpl.colorPalette[i];
-        if (c.size() == 3) {
-            out << "const vec3 color" << i
-                << " = vec3(" << c[0] << ", "
-                              << c[1] << ", "
-                              << c[2] << ");\n";
+        if (c.size() != 3) continue;
+        out += "const vec3 color";
+        shaderIR::appendInt(out, i);
+        out += " = vec3(";
+        for (int k = 0; k < 3; ++k) {
+            if (k) out += ", ";
+            const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), static_cast<double>(c[k]),
+                                                         std::chars_format::general, 6);
+            out.append(buf, r.ptr);
         }
+        out += ");\n";
     }
-    return out.str();
+}
+std::string getColorPalette(const ShaderTemplate &tmpl) {
+    std::string out;
+    appendColorPalette(out, tmpl);
+    return out;
 }
 
 
-//assembles code from all components of element
-inline Emitted getFullElement(const ShaderElement &element, int elementIndex){
-    // figure out this part
-    Emitted output;
-    auto addToOutput = [&](const Emitted& em){ output.helpers += em.helpers; output.calls += em.calls; }; // lambda emitter outputs . [&] is a capture of an instance of the emmiter struct. 1line function for taking emmited snippet and adding to output
+// registry ids for one element's names. resolved once per element, then every
+// emitter dispatches by id instead of re-walking its name list
+struct ElementIds {
+  int structure;
+  int texture;
+  int symmetry;
+  int color;
+  int layering;
+  int behavior;
+};
+
+inline ElementIds resolveElement(const ShaderElement &element) {
+  return ElementIds{structures::registry().id(element.structure),
+                    textures::registry().id(element.texture),
+                    symmetry::registry().id(element.symmetry),
+                    color::registry().id(element.colorUsage),
+                    layering::registry().id(element.layering),
+                    behave::registry().id(element.elementBehavior)};
+}
+
+//assembles the IR for all components of element into ir
+inline void buildElement(shaderIR::Program &ir, const ShaderElement &element, int elementIndex){
+    ir.beginElement(elementIndex);
+    const ElementIds ids = resolveElement(element);
 
     //ORDER IS CRUCIAL HERE, does not matter when creating template instances
 
-    addToOutput(symmetry::emitElementSymmetry(element, elementIndex));
-    addToOutput(structures::emitElementPlacement( element, elementIndex));
-    addToOutput(structures::emitElementSize( element, elementIndex));
-    addToOutput(behave::emitElementBehavior(element, elementIndex, behave::BehaviorPhase::UV)); //phase 1 - before structure
-    addToOutput(structures::emitElementStructure(element, elementIndex));
-    addToOutput(behave::emitElementBehavior(element, elementIndex, behave::BehaviorPhase::VAL)); //phase 2 - after structure
-    addToOutput(textures::emitElementTexture(element, elementIndex));
-    addToOutput(color::emitElementColor(element, elementIndex));
-    addToOutput(layering::emitElementLayering(element, elementIndex));
+    symmetry::emitElementSymmetry(ir, element, elementIndex, ids.symmetry);
+    structures::emitElementPlacement(ir, element, elementIndex);
+    structures::emitElementSize(ir, element, elementIndex);
+    behave::emitElementBehavior(ir, element, elementIndex, behave::BehaviorPhase::UV, ids.behavior); //phase 1 - before structure
+    structures::emitElementStructure(ir, element, elementIndex, ids.structure);
+    behave::emitElementBehavior(ir, element, elementIndex, behave::BehaviorPhase::VAL, ids.behavior); //phase 2 - after structure
+    textures::emitElementTexture(ir, element, elementIndex, ids.texture);
+    color::emitElementColor(ir, element, elementIndex, ids.color);
+    layering::emitElementLayering(ir, element, elementIndex, ids.layering);
+}
+
+// "#define QUALITY n" ahead of the helpers, only when one of them has LOD tiers
+inline void appendQualityDefine(std::string &out, const std::vector<const shaderIR::HelperDef *> &helpers,
+                                int quality) {
+  for (const shaderIR::HelperDef *h : helpers) {
+    if (!h->hasTiers()) continue;
+    out += "#define QUALITY ";
+    shaderIR::appendInt(out, std::max(0, std::min(2, quality)));
+    out += "\n";
+    return;
+  }
+}
+
+// helpers already written into the shader. helpers are shared by name across
+// elements (waveGrid, fbmTone, blendOverlay, ...), so each only needs to
+// reach the driver once
+using HelperSet = std::unordered_set<const shaderIR::HelperDef *>;
 
+// one element printed on its own as GLSL (helpers + main() lines)
+// pass the shader's HelperSet to skip helpers an earlier element already emitted
+inline Emitted getFullElement(const ShaderElement &element, int elementIndex, HelperSet *seenHelpers = nullptr){
+    shaderIR::Program ir;
+    buildElement(ir, element, elementIndex);
+
+    Emitted output;
+    std::vector<const shaderIR::HelperDef *> fresh;
+    for (const shaderIR::HelperDef *h : ir.helpers) {
+        if (!seenHelpers || seenHelpers->insert(h).second) fresh.push_back(h);
+    }
+    appendQualityDefine(output.helpers, fresh, 2); // identical redefinitions are legal
+    for (const shaderIR::HelperDef *h : fresh) shaderIR::appendHelper(output.helpers, *h);
+    shaderIR::appendStatements(output.calls, ir);
     return output;
-    
 }
 
 
 
 /// THIS SECTION DEALS WITH THE "MAIN" FUNCTION in the glsl file //////
-std::string getMainFunction(const ShaderTemplate &tmpl,
-                            const std::string &injectedBody) {
-  std::ostringstream mainFunction;
-  mainFunction <<
-      R"GLSL(
+// main() is written in two halves so the body can be printed straight into
+// the same buffer in between
+inline void appendMainBegin(std::string &out) {
+  out += R"GLSL(
 void main() {
     vec2 uv = vPos.xy;
     float t = u_time;
     vec3 col = vec3(0.0);
 
 )GLSL";
-  mainFunction << injectedBody;
-
+}
+inline void appendMainEnd(std::string &out, const ShaderTemplate &tmpl) {
   if (tmpl.hasBackground) {
-    mainFunction << "    col = mix(col, vec3" << tmpl.backgroundColor
-                 << ", 0.1);\n";
+    out += "    col = mix(col, vec3";
+    out += tmpl.backgroundColor;
+    out += ", 0.1);\n";
   }
-  mainFunction << "    fragColor = vec4(col, 1.0);\n}\n";
-  return mainFunction.str();
+  out += "    fragColor = vec4(col, 1.0);\n}\n";
+}
+
+std::string getMainFunction(const ShaderTemplate &tmpl,
+                            const std::string &injectedBody) {
+  std::string out;
+  appendMainBegin(out);
+  out += injectedBody;
+  appendMainEnd(out, tmpl);
+  return out;
 }
 
 
 
-// MASTER FUNCTION FOR GENERATING CODE /// 
-std::string generateShaderCode(const shaderLib::ShaderTemplate &tmpl) {
-  std::ostringstream glslString;
+// builds the IR for every element, in order, into ir
+inline void buildTemplate(shaderIR::Program &ir, const ShaderTemplate &tmpl) {
+  ir.clear();
+  for (int i = 0; i < static_cast<int>(tmpl.elements.size()); ++i) {
+    buildElement(ir, tmpl.elements[i], i);
+  }
+}
+
+// switch an already generated shader to another QUALITY tier (e.g. on a slower
+// render node) without regenerating it. false if the shader has no tiers
+inline bool setShaderQuality(std::string &glsl, int quality) {
+  const std::string key = "#define QUALITY ";
+  const size_t at = glsl.find(key);
+  if (at == std::string::npos) return false;
+  glsl[at + key.size()] = static_cast<char>('0' + std::max(0, std::min(2, quality)));
+  return true;
+}
+
+// GLSL backend: appends a built Program with the template's header/uniforms/palette
+// samplers: extra sampler2D uniforms the program reads (baked layers, ShaderBake.hpp)
+inline void appendShaderCode(std::string &glsl, const ShaderTemplate &tmpl, const shaderIR::Program &ir,
+                             int quality = 2, const std::vector<std::string> &samplers = {},
+                             bool uniformBlock = false) {
+  appendHeader(glsl);
+  appendUniforms(glsl, tmpl, uniformBlock);
+  for (const std::string &s : samplers) {
+    glsl += "uniform sampler2D ";
+    glsl += s;
+    glsl += ";\n";
+  }
+  appendColorPalette(glsl, tmpl);
+
+  // helpers from selected element functions (top-level), then main body (inside main)
+  appendQualityDefine(glsl, ir.helpers, quality);
+  shaderIR::appendHelpers(glsl, ir);
+  appendMainBegin(glsl);
+  shaderIR::appendStatements(glsl, ir);
+  appendMainEnd(glsl, tmpl);
+}
 
-  //
-  glslString << shaderLib::getHeader();
-  glslString << shaderLib::getUniforms(tmpl);
-  glslString << shaderLib::getColorPalette(tmpl);
-  
-  // Collect helpers from selected element functions (top-level) and main body (inside main)
-  std::string helpers;
-  std::string body;
+inline std::string printShaderCode(const ShaderTemplate &tmpl, const shaderIR::Program &ir,
+                                   int quality = 2, const std::vector<std::string> &samplers = {},
+                                   bool uniformBlock = false) {
+  std::string glsl;
+  appendShaderCode(glsl, tmpl, ir, quality, samplers, uniformBlock);
+  return glsl;
+}
 
-  for (int i = 0; i < tmpl.elements.size(); ++i) {
+// per-pixel / per-frame cost estimate of a template as it would be generated
+inline CostEstimate estimateTemplateCost(const ShaderTemplate &tmpl,
+                                         const CostCalibration &calibration = {}) {
+  shaderIR::Program ir;
+  buildTemplate(ir, tmpl);
+  shaderIR::optimize(ir);
+  return estimateCost(ir, static_cast<int>(tmpl.elements.size()), calibration);
+}
 
-    const auto &element = tmpl.elements[i]; // fetches the current element - just a concise way of writing
+/**
+ * @brief Reusable generation context: the IR, optimiser scratch and output
+ * buffer stay allocated between calls, so once it has seen a template of a
+ * given size, generating more of them does no heap allocation at all (budget
+ * downgrades aside). One per thread.
+ */
+class ShaderGenerator {
+public:
+  explicit ShaderGenerator(GeneratorOptions options = {}) : mOptions(options) {}
+
+  // GLSL for tmpl, see generateShaderCode. valid until the next call
+  const std::string &generate(const ShaderTemplate &tmpl, shaderIR::OptimizeStats *stats = nullptr);
+
+  GeneratorOptions &options() { return mOptions; }
+
+private:
+  GeneratorOptions mOptions;
+  shaderIR::Program mIR;
+  shaderIR::Optimizer mOptimizer;
+  ShaderTemplate mDowngraded;
+  std::string mCode;
+};
+
+inline const std::string &ShaderGenerator::generate(const ShaderTemplate &tmpl, shaderIR::OptimizeStats *stats) {
+  const ShaderTemplate *current = &tmpl;
+  int quality = mOptions.quality;
+  mCode.clear();
+  for (;;) {
+    buildTemplate(mIR, *current);
+    if (mOptions.optimize) {
+      const shaderIR::OptimizeStats s = mOptimizer.run(mIR);
+      if (stats) *stats = s;
+    }
+    if (mOptions.budgetMs <= 0.0) break;
+
+    const int elementCount = static_cast<int>(current->elements.size());
+    CostEstimate est = estimateCost(mIR, elementCount, mOptions.calibration, quality);
+    // lower tiers only change the helpers' QUALITY branch - same IR, re-estimate
+    while (est.ms > mOptions.budgetMs && mOptions.downgradeOverBudget && quality > 0 &&
+           hasQualityTiers(mIR)) {
+      --quality;
+      std::cerr << "WARNING: Template over budget; quality lowered to " << quality << std::endl;
+      est = estimateCost(mIR, elementCount, mOptions.calibration, quality);
+    }
+    if (est.ms <= mOptions.budgetMs) break;
 
-    shaderLib::Emitted elementOutput = shaderLib::getFullElement(tmpl.elements[i], i);
-    helpers += elementOutput.helpers;
-    body    += elementOutput.calls;
+    if (current == &tmpl) {
+      mDowngraded = tmpl;
+      current = &mDowngraded;
+    }
+    if (!mOptions.downgradeOverBudget || !downgradeMostExpensive(mDowngraded, est)) {
+      std::cerr << "ERROR: Template estimated at " << est.ms << " ms/frame, over the "
+                << mOptions.budgetMs << " ms budget" << std::endl;
+      return mCode;
+    }
   }
+  appendShaderCode(mCode, *current, mIR, quality, {}, mOptions.uniformBlock);
+  return mCode;
+}
 
-  glslString << helpers;
-  glslString << shaderLib::getMainFunction(tmpl, body);
-  return glslString.str();
+// MASTER FUNCTION FOR GENERATING CODE /// 
+// stats (optional) gets the instruction counts before/after optimisation.
+// with options.budgetMs set, a template estimated over budget first drops to
+// lower QUALITY tiers, then is downgraded element by element until it fits, or
+// is rejected: returns "" in that case. loops generating many shaders should
+// keep a ShaderGenerator instead
+inline std::string generateShaderCode(const shaderLib::ShaderTemplate &tmpl,
+                                      const GeneratorOptions &options = {},
+                                      shaderIR::OptimizeStats *stats = nullptr) {
+  ShaderGenerator generator(options);
+  return generator.generate(tmpl, stats);
 }
 
 // takes code from generateShaderCode and writes to a frag //
@@ -7,6 +7,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 
@@ -27,7 +29,7 @@ struct ShaderElement {
   std::string colorUsage;///< Valid: "primary", "secondary", "accent", "alt"
   std::string elementBehavior;///< Valid:"scaleWith", "sineMod", "rotateUV", "scrollUV", "threshWith"
   std::string behaviorUniform;///< Enter one of from the uniform vector. Such as u_time, etc
-  double speed;///< enter a speed multiplier. default is 1.0 //maybe change this to be a uniform 
+  double speed = 1.0;///< enter a speed multiplier. default is 1.0 //maybe change this to be a uniform 
 
 };
 ////
@@ -35,13 +37,44 @@ struct ShaderElement {
 // from the shader string library
 ////
 struct ShaderTemplate {
-  bool hasBackground; ///< boolean
+  bool hasBackground = false; ///< boolean
   std::string backgroundColor; ///<  (value1, value2, value3)
   ColorPalette colorPalette;
   std::vector<std::string> globalUniforms;
   std::vector<ShaderElement> elements; // vector of elements
 };
 
+// === Per-frame uniform block === //
+// The time / audio values every voice sends each frame, as one std140 block.
+// The layout is fixed (not per template) so that every program declaring it
+// can read the same buffer. FrameBlock is the CPU side: floats only, which
+// std140 packs at 4-byte offsets, so the struct's memory is the buffer.
+// kFrameBlockMembers lists the GLSL names in the same order as the fields.
+constexpr const char *kFrameBlockName = "FrameUniforms";
+constexpr unsigned kFrameBlockBinding = 0; ///< uniform buffer binding point
+constexpr const char *kFrameBlockMembers[] = {"u_time", "onset", "cent", "flux", "rms"};
+constexpr int kFrameBlockMemberCount = sizeof(kFrameBlockMembers) / sizeof(kFrameBlockMembers[0]);
+
+struct FrameBlock {
+  float u_time = 0.0f;
+  float onset = 0.0f;
+  float cent = 0.0f;
+  float flux = 0.0f;
+  float rms = 0.0f;
+  float pad[3] = {}; ///< rounds the block up to a vec4 multiple
+};
+static_assert(sizeof(FrameBlock) == 32 && kFrameBlockMemberCount == 5,
+              "FrameBlock fields and kFrameBlockMembers must match");
+
+// one uniform array a fused loop reads (shaderLib/ShaderFused.hpp):
+// uniform float/vec2/vec3 name[count]. ShadedMesh::uniformArray sends it
+struct FusedUniform {
+  std::string name;
+  int components = 1;
+  int count = 0;
+  std::vector<float> values; ///< count * components, element order
+};
+
 // a pair of strings: top-level helpers + main() statements
 struct Emitted {
   std::string helpers; // GLSL functions/defs (top-level)
@@ -54,4 +87,37 @@ inline bool isBlank(const std::string& s) {
   return s.empty() || s == " " || s == "  ";
 }
 
+// === Emitter registry === //
+// Each emitter family (structures, textures, ...) keeps one table of entries,
+// built once. A name is hashed a single time into an id, and the id indexes
+// straight into the entry table, so dispatch is O(1) no matter how many names
+// the library grows. Entry types just need a `const char *name` member.
+template <typename Entry>
+class EmitterRegistry {
+public:
+  static constexpr int kUnknown = -1;
+
+  EmitterRegistry(std::initializer_list<Entry> entries) : mEntries(entries) {
+    mIds.reserve(mEntries.size());
+    for (int i = 0; i < static_cast<int>(mEntries.size()); ++i) {
+      mIds.emplace(mEntries[i].name, i); // keys view the entry's string literal
+    }
+  }
+
+  // interned id for a name, or kUnknown
+  int id(std::string_view name) const {
+    auto it = mIds.find(name);
+    return it == mIds.end() ? kUnknown : it->second;
+  }
+
+  const Entry &operator[](int id) const { return mEntries[id]; }
+  size_t size() const { return mEntries.size(); }
+  typename std::vector<Entry>::const_iterator begin() const { return mEntries.begin(); }
+  typename std::vector<Entry>::const_iterator end() const { return mEntries.end(); }
+
+private:
+  std::vector<Entry> mEntries;
+  std::unordered_map<std::string_view, int> mIds;
+};
+
 }
\ No newline at end of file
@@ -0,0 +1,550 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../shaderLib/ShaderCompact.hpp"
+#include "../shaderLib/ShaderLibJson.hpp"
+#include "../shaderLib/ShaderLibUtility.hpp"
+
+// === Binary template libraries === //
+// A library file holds any number of named ShaderTemplates and is meant to be
+// mmapped and read in place: open() checks the header and nothing else, and
+// view(i) finds template i through an offset index without parsing the others.
+// Layout (little-endian, every section 8-byte aligned):
+//
+//   LibraryHeader
+//   records      one per template: TemplateRecord, uint32 uniforms[],
+//                uint32 colorSizes[], float colorData[], pad, ElementRecord[]
+//   index        uint64 record offset per template
+//   strings      uint32 offsets[stringCount + 1], then the characters
+//
+// Every name (emitter names, uniforms, background colour, the template's own
+// name) is an id into the string table, so files stay valid when emitter
+// registries change between builds. Bump kLibraryVersion whenever a record
+// layout changes; readers refuse other versions.
+//
+// JSONL (one ShaderLibJson.hpp record per line, "name" included) is the
+// hand-editable side: importJsonl / exportJsonl convert between the two, and
+// src/TemplateLibraryTool.cpp wraps them on the command line.
+
+namespace shaderLib {
+
+constexpr uint32_t kLibraryVersion = 1;
+constexpr char kLibraryMagic[8] = {'S', 'H', 'D', 'R', 'L', 'I', 'B', '\0'};
+constexpr uint32_t kLibraryByteOrder = 0x01020304;
+
+struct LibraryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t templateCount;
+  uint64_t indexOffset;
+  uint64_t stringCount;
+  uint64_t stringOffset;
+  uint64_t fileSize;
+};
+
+struct TemplateRecord {
+  uint32_t name;
+  uint32_t backgroundColor;
+  uint32_t hasBackground;
+  uint32_t uniformCount;
+  uint32_t colorCount;
+  uint32_t colorComponents; ///< floats in colorData (sum of colorSizes)
+  uint32_t elementCount;
+  uint32_t reserved;
+};
+
+struct ElementRecord {
+  uint32_t structure;
+  uint32_t texture;
+  uint32_t symmetry;
+  uint32_t layering;
+  uint32_t colorUsage;
+  uint32_t elementBehavior;
+  uint32_t behaviorUniform;
+  uint32_t placementCount; ///< 0..2
+  float size;
+  uint32_t reserved;
+  double placement[2];
+  double speed;
+};
+
+static_assert(sizeof(LibraryHeader) == 56, "library layout changed - bump kLibraryVersion");
+static_assert(sizeof(TemplateRecord) == 32, "library layout changed - bump kLibraryVersion");
+static_assert(sizeof(ElementRecord) == 64, "library layout changed - bump kLibraryVersion");
+
+namespace detail {
+inline uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+} // namespace detail
+
+/**
+ * @brief Streams templates into a library file. Records go straight to disk;
+ * only the offset index and the string table stay in memory until finish().
+ */
+class TemplateLibraryWriter {
+public:
+  TemplateLibraryWriter() = default;
+  TemplateLibraryWriter(const TemplateLibraryWriter &) = delete;
+  TemplateLibraryWriter &operator=(const TemplateLibraryWriter &) = delete;
+  ~TemplateLibraryWriter() {
+    if (mOut.is_open()) finish();
+  }
+
+  bool open(const std::string &path) {
+    mOut.open(path, std::ios::binary | std::ios::trunc);
+    if (!mOut.is_open()) {
+      std::cerr << "ERROR: could not open library " << path << " for writing" << std::endl;
+      return false;
+    }
+    mOffsets.clear();
+    mStrings.clear();
+    mStringIds.clear();
+    mPos = 0;
+    LibraryHeader header{};
+    write(&header, sizeof header); // rewritten by finish()
+    return true;
+  }
+
+  // false (with an ERROR) if tmpl can't be stored as is: an element with more
+  // than two placement coords. the first two are still written
+  bool add(const ShaderTemplate &tmpl, const std::string &name = "") {
+    if (!mOut.is_open()) return false;
+    bool ok = true;
+    mOffsets.push_back(mPos);
+
+    TemplateRecord record{};
+    record.name = intern(name);
+    record.backgroundColor = intern(tmpl.backgroundColor);
+    record.hasBackground = tmpl.hasBackground ? 1u : 0u;
+    record.uniformCount = static_cast<uint32_t>(tmpl.globalUniforms.size());
+    record.colorCount = static_cast<uint32_t>(tmpl.colorPalette.size());
+    for (const Color &c : tmpl.colorPalette) record.colorComponents += static_cast<uint32_t>(c.size());
+    record.elementCount = static_cast<uint32_t>(tmpl.elements.size());
+    write(&record, sizeof record);
+
+    for (const std::string &u : tmpl.globalUniforms) writeU32(intern(u));
+    for (const Color &c : tmpl.colorPalette) writeU32(static_cast<uint32_t>(c.size()));
+    for (const Color &c : tmpl.colorPalette) write(c.data(), c.size() * sizeof(float));
+    pad();
+
+    for (const ShaderElement &e : tmpl.elements) {
+      ElementRecord r{};
+      r.structure = intern(e.structure);
+      r.texture = intern(e.texture);
+      r.symmetry = intern(e.symmetry);
+      r.layering = intern(e.layering);
+      r.colorUsage = intern(e.colorUsage);
+      r.elementBehavior = intern(e.elementBehavior);
+      r.behaviorUniform = intern(e.behaviorUniform);
+      r.placementCount = static_cast<uint32_t>(std::min<size_t>(e.placementCoords.size(), 2));
+      for (uint32_t k = 0; k < r.placementCount; ++k) r.placement[k] = e.placementCoords[k];
+      if (e.placementCoords.size() > 2) {
+        std::cerr << "ERROR: template " << mOffsets.size() - 1 << " placementCoords has "
+                  << e.placementCoords.size() << " values; library keeps 2" << std::endl;
+        ok = false;
+      }
+      r.size = e.size;
+      r.speed = e.speed;
+      write(&r, sizeof r);
+    }
+    return ok;
+  }
+
+  // writes the index, string table and header; false on an I/O error
+  bool finish() {
+    if (!mOut.is_open()) return false;
+    LibraryHeader header{};
+    std::memcpy(header.magic, kLibraryMagic, sizeof header.magic);
+    header.version = kLibraryVersion;
+    header.byteOrder = kLibraryByteOrder;
+    header.templateCount = mOffsets.size();
+    header.indexOffset = mPos;
+    write(mOffsets.data(), mOffsets.size() * sizeof(uint64_t));
+
+    header.stringCount = mStrings.size();
+    header.stringOffset = mPos;
+    uint32_t at = 0;
+    for (const std::string &s : mStrings) {
+      writeU32(at);
+      at += static_cast<uint32_t>(s.size());
+    }
+    writeU32(at);
+    for (const std::string &s : mStrings) write(s.data(), s.size());
+    pad();
+    header.fileSize = mPos;
+
+    mOut.seekp(0);
+    mOut.write(reinterpret_cast<const char *>(&header), sizeof header);
+    const bool ok = static_cast<bool>(mOut);
+    mOut.close();
+    if (!ok) std::cerr << "ERROR: failed writing template library" << std::endl;
+    return ok;
+  }
+
+  size_t size() const { return mOffsets.size(); }
+
+private:
+  uint32_t intern(const std::string &s) {
+    auto it = mStringIds.find(s);
+    if (it != mStringIds.end()) return it->second;
+    const uint32_t id = static_cast<uint32_t>(mStrings.size());
+    mStrings.push_back(s);
+    mStringIds.emplace(s, id);
+    return id;
+  }
+
+  void write(const void *data, size_t bytes) {
+    mOut.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+    mPos += bytes;
+  }
+  void writeU32(uint32_t v) { write(&v, sizeof v); }
+  void pad() {
+    static const char zeros[8] = {};
+    write(zeros, detail::align8(mPos) - mPos);
+  }
+
+  std::ofstream mOut;
+  uint64_t mPos = 0;
+  std::vector<uint64_t> mOffsets;
+  std::vector<std::string> mStrings;
+  std::unordered_map<std::string, uint32_t> mStringIds;
+};
+
+class TemplateLibrary;
+
+// one record, read in place. only valid while its library stays open
+class TemplateView {
+public:
+  bool valid() const { return mRecord != nullptr; }
+  std::string_view name() const;
+  std::string_view backgroundColor() const;
+  bool hasBackground() const { return mRecord->hasBackground != 0; }
+  uint32_t uniformCount() const { return mRecord->uniformCount; }
+  std::string_view uniform(uint32_t i) const;
+  uint32_t colorCount() const { return mRecord->colorCount; }
+  uint32_t elementCount() const { return mRecord->elementCount; }
+  const ElementRecord &element(uint32_t i) const { return mElements[i]; }
+  std::string_view string(uint32_t id) const; ///< an ElementRecord name field
+
+  ShaderTemplate expand() const;
+  // straight into the compact form (ShaderCompact.hpp), without building std::strings
+  // for names the emitter registries know
+  bool compact(CompactTemplate &out, NamePool &pool) const;
+
+private:
+  friend class TemplateLibrary;
+  const TemplateLibrary *mLibrary = nullptr;
+  const TemplateRecord *mRecord = nullptr;
+  const uint32_t *mUniforms = nullptr;
+  const uint32_t *mColorSizes = nullptr;
+  const float *mColorData = nullptr;
+  const ElementRecord *mElements = nullptr;
+};
+
+/**
+ * @brief A library file opened read-only. mmapped where available (the whole
+ * file is read into memory elsewhere); open() only validates the header, so
+ * opening is O(1) in the number of templates.
+ */
+class TemplateLibrary {
+public:
+  TemplateLibrary() = default;
+  TemplateLibrary(const TemplateLibrary &) = delete;
+  TemplateLibrary &operator=(const TemplateLibrary &) = delete;
+  ~TemplateLibrary() { close(); }
+
+  bool open(const std::string &path) {
+    close();
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "ERROR: could not open library " << path << std::endl;
+      return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+      if (map != MAP_FAILED) {
+        mData = static_cast<const char *>(map);
+        mSize = static_cast<size_t>(st.st_size);
+        mMapped = true;
+      }
+    }
+    ::close(fd);
+#endif
+    if (!mData) {
+      std::ifstream in(path, std::ios::binary);
+      if (!in.is_open()) {
+        std::cerr << "ERROR: could not open library " << path << std::endl;
+        return false;
+      }
+      mBuffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      mData = mBuffer.data();
+      mSize = mBuffer.size();
+    }
+    if (!checkHeader(path)) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+#ifndef _WIN32
+    if (mMapped) ::munmap(const_cast<char *>(mData), mSize);
+#endif
+    mMapped = false;
+    mData = nullptr;
+    mSize = 0;
+    mBuffer.clear();
+    mBuffer.shrink_to_fit();
+  }
+
+  bool isOpen() const { return mData != nullptr; }
+  size_t size() const { return isOpen() ? static_cast<size_t>(header().templateCount) : 0; }
+
+  // record i, read in place. !valid() (with an ERROR) if it's out of range or
+  // doesn't fit the file
+  TemplateView view(size_t i) const {
+    TemplateView v;
+    if (i >= size()) {
+      std::cerr << "ERROR: template " << i << " out of range (" << size() << ")" << std::endl;
+      return v;
+    }
+    const uint64_t begin = index()[i];
+    const uint64_t end = (i + 1 < size()) ? index()[i + 1] : header().indexOffset;
+    if (begin % 8 != 0 || end > header().indexOffset || begin > end || end - begin < sizeof(TemplateRecord)) {
+      std::cerr << "ERROR: template " << i << " record is corrupt" << std::endl;
+      return v;
+    }
+    const TemplateRecord *r = reinterpret_cast<const TemplateRecord *>(mData + begin);
+    uint64_t at = begin + sizeof(TemplateRecord);
+    const uint64_t uniforms = at;
+    at += uint64_t(r->uniformCount) * 4;
+    const uint64_t colorSizes = at;
+    at += uint64_t(r->colorCount) * 4;
+    const uint64_t colorData = at;
+    at = detail::align8(at + uint64_t(r->colorComponents) * 4);
+    const uint64_t elements = at;
+    at += uint64_t(r->elementCount) * sizeof(ElementRecord);
+    uint64_t components = 0;
+    const uint32_t *sizes = reinterpret_cast<const uint32_t *>(mData + colorSizes);
+    if (at <= end) {
+      for (uint32_t k = 0; k < r->colorCount; ++k) components += sizes[k];
+    }
+    if (at > end || components != r->colorComponents) {
+      std::cerr << "ERROR: template " << i << " record is corrupt" << std::endl;
+      return v;
+    }
+    v.mLibrary = this;
+    v.mRecord = r;
+    v.mUniforms = reinterpret_cast<const uint32_t *>(mData + uniforms);
+    v.mColorSizes = reinterpret_cast<const uint32_t *>(mData + colorSizes);
+    v.mColorData = reinterpret_cast<const float *>(mData + colorData);
+    v.mElements = reinterpret_cast<const ElementRecord *>(mData + elements);
+    return v;
+  }
+
+  ShaderTemplate get(size_t i) const {
+    const TemplateView v = view(i);
+    return v.valid() ? v.expand() : ShaderTemplate{};
+  }
+
+  // string table entry; "" for an id past the table
+  std::string_view string(uint32_t id) const {
+    if (id >= header().stringCount) return {};
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(mData + header().stringOffset);
+    const char *chars = reinterpret_cast<const char *>(offsets + header().stringCount + 1);
+    if (offsets[id] > offsets[id + 1] || offsets[id + 1] > offsets[header().stringCount]) return {};
+    return std::string_view(chars + offsets[id], offsets[id + 1] - offsets[id]);
+  }
+
+private:
+  const LibraryHeader &header() const { return *reinterpret_cast<const LibraryHeader *>(mData); }
+  const uint64_t *index() const { return reinterpret_cast<const uint64_t *>(mData + header().indexOffset); }
+
+  bool checkHeader(const std::string &path) {
+    auto fail = [&](const char *why) {
+      std::cerr << "ERROR: library " << path << ": " << why << std::endl;
+      return false;
+    };
+    if (mSize < sizeof(LibraryHeader)) return fail("too small");
+    const LibraryHeader &h = header();
+    if (std::memcmp(h.magic, kLibraryMagic, sizeof h.magic) != 0) return fail("not a template library");
+    if (h.byteOrder != kLibraryByteOrder) return fail("written with the other byte order");
+    if (h.version != kLibraryVersion) return fail("unsupported version");
+    if (h.fileSize != mSize) return fail("truncated");
+    // counts come from the file: divide the room instead of multiplying them,
+    // so a huge count can't wrap around and pass
+    if (h.indexOffset % 8 != 0 || h.indexOffset < sizeof(LibraryHeader) || h.indexOffset > h.stringOffset ||
+        h.stringOffset > mSize || h.templateCount > (h.stringOffset - h.indexOffset) / 8) {
+      return fail("bad index");
+    }
+    if (h.stringOffset % 8 != 0 || h.stringCount >= (mSize - h.stringOffset) / 4) return fail("bad string table");
+    const uint32_t *offsets = reinterpret_cast<const uint32_t *>(mData + h.stringOffset);
+    const uint64_t stringData = h.stringOffset + (h.stringCount + 1) * 4;
+    if (offsets[h.stringCount] > mSize - stringData) return fail("bad string table");
+    return true;
+  }
+
+  const char *mData = nullptr;
+  size_t mSize = 0;
+  bool mMapped = false;
+  std::vector<char> mBuffer; ///< file contents where mmap isn't available
+};
+
+inline std::string_view TemplateView::string(uint32_t id) const { return mLibrary->string(id); }
+inline std::string_view TemplateView::name() const { return string(mRecord->name); }
+inline std::string_view TemplateView::backgroundColor() const { return string(mRecord->backgroundColor); }
+inline std::string_view TemplateView::uniform(uint32_t i) const { return string(mUniforms[i]); }
+
+inline ShaderTemplate TemplateView::expand() const {
+  ShaderTemplate out;
+  out.hasBackground = hasBackground();
+  out.backgroundColor = std::string(backgroundColor());
+  for (uint32_t i = 0; i < uniformCount(); ++i) out.globalUniforms.emplace_back(uniform(i));
+  const float *c = mColorData;
+  for (uint32_t i = 0; i < colorCount(); ++i) {
+    out.colorPalette.emplace_back(c, c + mColorSizes[i]);
+    c += mColorSizes[i];
+  }
+  out.elements.resize(elementCount());
+  for (uint32_t i = 0; i < elementCount(); ++i) {
+    const ElementRecord &r = mElements[i];
+    ShaderElement &e = out.elements[i];
+    e.structure = std::string(string(r.structure));
+    e.texture = std::string(string(r.texture));
+    e.symmetry = std::string(string(r.symmetry));
+    e.layering = std::string(string(r.layering));
+    e.colorUsage = std::string(string(r.colorUsage));
+    e.elementBehavior = std::string(string(r.elementBehavior));
+    e.behaviorUniform = std::string(string(r.behaviorUniform));
+    e.placementCoords.assign(r.placement, r.placement + std::min<uint32_t>(r.placementCount, 2));
+    e.size = r.size;
+    e.speed = r.speed;
+  }
+  return out;
+}
+
+inline bool TemplateView::compact(CompactTemplate &out, NamePool &pool) const {
+  out = CompactTemplate{};
+  bool ok = true;
+  const size_t refused = pool.refused();
+  auto over = [&](const char *what, uint32_t count, int cap) {
+    std::cerr << "ERROR: Template has " << count << " " << what << "; compact form holds " << cap << std::endl;
+    ok = false;
+  };
+  auto name = [&](const auto &registry, uint32_t id) -> NameId {
+    const std::string_view s = string(id);
+    const int known = registry.id(s);
+    if (known >= 0) return static_cast<NameId>(known);
+    return static_cast<NameId>(kPooled | pool.intern(std::string(s)));
+  };
+
+  out.hasBackground = hasBackground();
+  out.backgroundColor = pool.intern(std::string(backgroundColor()));
+  if (uniformCount() > CompactTemplate::kMaxUniforms) over("uniforms", uniformCount(), CompactTemplate::kMaxUniforms);
+  out.uniformCount = static_cast<uint8_t>(std::min<uint32_t>(uniformCount(), CompactTemplate::kMaxUniforms));
+  for (int i = 0; i < out.uniformCount; ++i) out.uniforms[i] = pool.intern(std::string(uniform(i)));
+
+  if (colorCount() > CompactTemplate::kMaxColors) over("colors", colorCount(), CompactTemplate::kMaxColors);
+  out.colorCount = static_cast<uint8_t>(std::min<uint32_t>(colorCount(), CompactTemplate::kMaxColors));
+  const float *c = mColorData;
+  for (int i = 0; i < out.colorCount; ++i) {
+    if (mColorSizes[i] > CompactTemplate::kMaxColorComponents) {
+      over("components in a color", mColorSizes[i], CompactTemplate::kMaxColorComponents);
+    }
+    out.colorSizes[i] = static_cast<uint8_t>(std::min<uint32_t>(mColorSizes[i], CompactTemplate::kMaxColorComponents));
+    std::memcpy(out.colors[i], c, out.colorSizes[i] * sizeof(float));
+    c += mColorSizes[i];
+  }
+
+  if (elementCount() > CompactTemplate::kMaxElements) over("elements", elementCount(), CompactTemplate::kMaxElements);
+  out.elementCount = static_cast<uint8_t>(std::min<uint32_t>(elementCount(), CompactTemplate::kMaxElements));
+  for (int i = 0; i < out.elementCount; ++i) {
+    const ElementRecord &r = mElements[i];
+    CompactElement &e = out.elements[i];
+    e.structure = name(structures::registry(), r.structure);
+    e.texture = name(textures::registry(), r.texture);
+    e.symmetry = name(symmetry::registry(), r.symmetry);
+    e.layering = name(layering::registry(), r.layering);
+    e.colorUsage = name(color::registry(), r.colorUsage);
+    e.behavior = name(behave::registry(), r.elementBehavior);
+    e.behaviorUniform = pool.intern(std::string(string(r.behaviorUniform)));
+    e.placementCount = static_cast<uint8_t>(std::min<uint32_t>(r.placementCount, 2));
+    e.placement[0] = r.placement[0];
+    e.placement[1] = r.placement[1];
+    e.size = r.size;
+    e.speed = r.speed;
+  }
+  if (pool.refused() != refused) {
+    std::cerr << "ERROR: NamePool is full; names no longer round-trip" << std::endl;
+    ok = false;
+  }
+  return ok;
+}
+
+// JSONL (ShaderLibJson.hpp records, one per line) -> library. malformed lines
+// are reported and skipped; returns the number of templates written, -1 if a
+// file couldn't be opened or written
+inline long long importJsonl(const std::string &jsonlPath, const std::string &libraryPath) {
+  std::ifstream in(jsonlPath);
+  if (!in.is_open()) {
+    std::cerr << "ERROR: could not open " << jsonlPath << std::endl;
+    return -1;
+  }
+  TemplateLibraryWriter writer;
+  if (!writer.open(libraryPath)) return -1;
+  std::string line;
+  long long lineNumber = 0;
+  while (std::getline(in, line)) {
+    ++lineNumber;
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+    try {
+      const nlohmann::json j = nlohmann::json::parse(line);
+      writer.add(j.get<ShaderTemplate>(), j.value("name", std::string()));
+    } catch (const std::exception &e) {
+      std::cerr << "ERROR: line " << lineNumber << ": " << e.what() << std::endl;
+    }
+  }
+  const long long count = static_cast<long long>(writer.size());
+  return writer.finish() ? count : -1;
+}
+
+// library -> JSONL, one record per line with its "name". -1 on an I/O error
+inline long long exportJsonl(const std::string &libraryPath, const std::string &jsonlPath) {
+  TemplateLibrary library;
+  if (!library.open(libraryPath)) return -1;
+  std::ofstream out(jsonlPath);
+  if (!out.is_open()) {
+    std::cerr << "ERROR: could not open " << jsonlPath << " for writing" << std::endl;
+    return -1;
+  }
+  long long count = 0;
+  for (size_t i = 0; i < library.size(); ++i) {
+    const TemplateView v = library.view(i);
+    if (!v.valid()) continue;
+    nlohmann::json j = v.expand();
+    if (!v.name().empty()) j["name"] = std::string(v.name());
+    out << j.dump() << '\n';
+    ++count;
+  }
+  return out ? count : -1;
+}
+
+} // namespace shaderLib
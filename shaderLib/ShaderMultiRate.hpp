@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../shaderLib/ShaderBake.hpp"
+#include "../shaderLib/ShaderCost.hpp"
+#include "../shaderLib/ShaderLibMaster.hpp"
+#include "../shaderLib/ShaderOptimize.hpp"
+
+// === Multi-rate rendering === //
+// An element driven by u_time * 0.2 (rotateUV at a low speed, julia's drifting
+// c) barely moves between two 60 Hz frames; one driven by an onset or flux
+// uniform can jump every frame. splitByRate() partitions a template:
+//   - traceRates(): like traceUniforms (ShaderBake.hpp), a forward pass over
+//     the optimised IR, but each variable carries how fast it changes - in
+//     units of u_time, so sin(u_time * 0.2) is 0.2. Constant factors scale it
+//     (speed, the coefficients inside helper bodies); any other uniform is
+//     treated as changing every frame
+//   - elements at or under slowRate form the slow partition. One offscreen
+//     pass (slowGlsl, one vec4 render target per element: layerCol_i, val_i)
+//     renders them over vPos.xy at slowHz
+//   - the per-frame shader (fastGlsl) reads those targets back with a fetch,
+//     exactly like a baked layer, and runs the fast elements and every
+//     element's layering live - col keeps changing with the fast layers
+// shaderUtility/multiRate.hpp drives the two passes with allolib.
+// Static elements land in the slow partition too; bakeStaticLayers goes
+// further for them (rendered once, on the CPU).
+
+namespace shaderLib {
+
+constexpr float kEveryFrame = std::numeric_limits<float>::infinity();
+
+namespace detail {
+
+// number ending just before text[at] (skipping spaces and a '*'), or -1
+inline double coefficientBefore(std::string_view text, size_t at) {
+  while (at > 0 && text[at - 1] == ' ') --at;
+  if (at == 0 || text[at - 1] != '*') return -1.0;
+  --at;
+  while (at > 0 && text[at - 1] == ' ') --at;
+  size_t begin = at;
+  while (begin > 0 && ((text[begin - 1] >= '0' && text[begin - 1] <= '9') || text[begin - 1] == '.')) --begin;
+  if (begin == at || (begin > 0 && isIdentChar(text[begin - 1]))) return -1.0;
+  return std::atof(std::string(text.substr(begin, at - begin)).c_str());
+}
+
+// number starting after text[at] (skipping spaces and a '*'), or -1
+inline double coefficientAfter(std::string_view text, size_t at) {
+  while (at < text.size() && text[at] == ' ') ++at;
+  if (at == text.size() || text[at] != '*') return -1.0;
+  ++at;
+  while (at < text.size() && text[at] == ' ') ++at;
+  const size_t begin = at;
+  while (at < text.size() && ((text[at] >= '0' && text[at] <= '9') || text[at] == '.')) ++at;
+  if (begin == at || (at < text.size() && isIdentChar(text[at]))) return -1.0;
+  return std::atof(std::string(text.substr(begin, at - begin)).c_str());
+}
+
+// fastest use of u_time in GLSL text: "u_time * 0.2" -> 0.2, bare -> 1, none -> 0
+inline float timeRate(std::string_view text) {
+  const std::string_view name = "u_time";
+  float rate = 0.0f;
+  for (size_t at = text.find(name); at != std::string_view::npos; at = text.find(name, at + 1)) {
+    const size_t end = at + name.size();
+    if ((at > 0 && isIdentChar(text[at - 1])) || (end < text.size() && isIdentChar(text[end]))) continue;
+    double c = coefficientAfter(text, end);
+    if (c < 0.0) c = coefficientBefore(text, at);
+    rate = std::max(rate, c < 0.0 ? 1.0f : static_cast<float>(c));
+  }
+  return rate;
+}
+
+class RateTracer : public VarTracer<RateTracer, float> {
+public:
+  RateTracer(const shaderIR::Program &p, const std::vector<std::string> &known) : VarTracer(p) {
+    for (const shaderIR::HelperDef *h : p.helpers) {
+      float rate = std::max(timeRate(h->preamble), timeRate(h->body));
+      for (const std::string &u : known) {
+        if (u != "u_time" && (mentions(h->preamble, u) || mentions(h->body, u))) rate = kEveryFrame;
+      }
+      mHelpers.push_back({h, rate});
+    }
+  }
+
+  std::vector<float> run() { return traceElements(); }
+
+private:
+  friend class VarTracer<RateTracer, float>;
+  static float join(float a, float b) { return std::max(a, b); }
+
+  float eval(shaderIR::ExprId id) const {
+    using shaderIR::Op;
+    const shaderIR::Expr &e = mP.exprs[id];
+    double c;
+    switch (e.op) {
+    case Op::Const:
+    case Op::Palette: return 0.0f;
+    case Op::Var: return at(e.var);
+    case Op::Uniform: {
+      const std::string_view name = mP.text(e.symbol);
+      if (name == "u_time") return 1.0f;
+      return isHelperDefine(mP, name) ? 0.0f : kEveryFrame;
+    }
+    case Op::Mul: // speed * u_time
+      if (constant(e.args[0], c)) return static_cast<float>(std::fabs(c)) * eval(e.args[1]);
+      if (constant(e.args[1], c)) return static_cast<float>(std::fabs(c)) * eval(e.args[0]);
+      break;
+    case Op::Div:
+      if (constant(e.args[1], c) && c != 0.0) return eval(e.args[0]) / static_cast<float>(std::fabs(c));
+      break;
+    default: break;
+    }
+    float r = 0.0f;
+    if (e.op == Op::Call && e.fn == shaderIR::Fn::Helper) {
+      for (const auto &h : mHelpers) {
+        if (h.def == e.helper) r = h.rate;
+      }
+    }
+    for (int i = 0; i < e.argc; ++i) r = std::max(r, eval(e.args[i]));
+    return r;
+  }
+
+  bool constant(shaderIR::ExprId id, double &v) const {
+    const shaderIR::Expr &e = mP.exprs[id];
+    if (e.op != shaderIR::Op::Const) return false;
+    v = e.value;
+    return true;
+  }
+
+  struct HelperRate {
+    const shaderIR::HelperDef *def;
+    float rate;
+  };
+
+  std::vector<HelperRate> mHelpers;
+};
+
+} // namespace detail
+
+// how fast each element's layer changes, in multiples of u_time (0 = static,
+// kEveryFrame = follows a uniform other than u_time). known: the template's
+// globalUniforms, to spot them inside helper bodies
+inline std::vector<float> traceRates(const shaderIR::Program &p, const std::vector<std::string> &known) {
+  return detail::RateTracer(p, known).run();
+}
+
+struct MultiRateOptions {
+  float slowRate = 0.5f; ///< elements changing at most this fast (x u_time) go slow
+  int size = 1024;       ///< slow targets are size x size
+  float extent = 15.0f;  ///< over vPos.xy in [-extent, extent]^2 (ShadedSphere radius)
+  int quality = 2;
+  double minUnits = 8.0; ///< keep elements cheaper than a fetch live
+  double frameHz = 60.0; ///< for averageMs
+  double slowHz = 15.0;  ///< how often the slow pass re-renders
+  int maxTargets = 8;    ///< render targets in one pass (GL_MAX_DRAW_BUFFERS is at least 8)
+};
+
+struct MultiRateShader {
+  std::string fastGlsl;             ///< every frame; samples u_slow<i>
+  std::string slowGlsl;             ///< offscreen, "" when nothing is slow
+  std::string slowVertex;           ///< fullscreen quad for slowGlsl
+  std::vector<int> slowElements;    ///< render target k holds element slowElements[k]
+  std::vector<std::string> samplers; ///< u_slow<i>, same order
+  std::vector<float> rates;         ///< per element (traceRates)
+  CostEstimate single; ///< the unsplit shader
+  CostEstimate fast;
+  CostEstimate slow;   ///< per slow-target pixel
+
+  /// average per-frame ms for both passes at the given output / slow rates
+  double averageMs(const MultiRateOptions &o, const CostCalibration &cal = {}) const {
+    if (slowElements.empty()) return fast.ms;
+    const double slowPixels = double(o.size) * double(o.size);
+    return fast.ms + slow.units * slowPixels / cal.unitsPerMs * (o.slowHz / o.frameHz);
+  }
+};
+
+// vertex shader of the slow pass: a [-1, 1] quad covering vPos.xy in
+// [-extent, extent]^2 - the same texels the fast shader samples
+inline std::string slowPassVertex(float extent) {
+  std::string v = R"GLSL(#version 330 core
+
+layout (location = 0) in vec3 position;
+
+out vec3 vPos;
+out vec2 vUV;
+
+void main() {
+    vPos = vec3(position.xy * )GLSL";
+  shaderIR::appendFloat(v, extent);
+  v += R"GLSL(, 0.0);
+    vUV = position.xy * 0.5 + 0.5;
+    gl_Position = vec4(position.xy, 0.0, 1.0);
+}
+)GLSL";
+  return v;
+}
+
+inline MultiRateShader splitByRate(const ShaderTemplate &tmpl, const MultiRateOptions &options = {}) {
+  using shaderIR::Var;
+  MultiRateShader out;
+  const int elementCount = static_cast<int>(tmpl.elements.size());
+  shaderIR::Program ir;
+  buildTemplate(ir, tmpl);
+  shaderIR::Optimizer optimizer;
+  optimizer.run(ir);
+  out.rates = traceRates(ir, tmpl.globalUniforms);
+  out.single = estimateCost(ir, elementCount, {}, options.quality);
+
+  std::vector<Var> liveOut;
+  for (int i = 0; i < static_cast<int>(out.rates.size()) && i < elementCount; ++i) {
+    if (out.rates[i] > options.slowRate || out.single.elementUnits[i] < options.minUnits) continue;
+    if (static_cast<int>(out.slowElements.size()) >= options.maxTargets) break;
+    if (!detail::writesLayer(ir, i)) continue;
+    out.slowElements.push_back(i);
+    out.samplers.push_back("u_slow" + std::to_string(i));
+    liveOut.push_back(Var::layerCol(i));
+    liveOut.push_back(Var::val(i));
+  }
+  if (out.slowElements.empty()) {
+    out.fast = out.single;
+    out.fastGlsl = printShaderCode(tmpl, ir, options.quality);
+    return out;
+  }
+
+  // slow pass: only what the slow layers need, col is not an output
+  shaderIR::Program slowIR = ir;
+  optimizer.run(slowIR, false, &liveOut);
+  out.slow = estimateCost(slowIR, elementCount, {}, options.quality);
+  {
+    std::string header = getHeader();
+    std::string targets;
+    for (size_t k = 0; k < out.slowElements.size(); ++k) {
+      targets += "layout(location = " + std::to_string(k) + ") out vec4 slow_" + std::to_string(k) + ";\n";
+    }
+    const std::string fragColor = "out vec4 fragColor;\n";
+    header.replace(header.find(fragColor), fragColor.size(), targets);
+    std::string &glsl = out.slowGlsl;
+    glsl = header;
+    glsl += getUniforms(tmpl);
+    glsl += getColorPalette(tmpl);
+    appendQualityDefine(glsl, slowIR.helpers, options.quality);
+    shaderIR::appendHelpers(glsl, slowIR);
+    glsl += "\nvoid main() {\n    vec2 uv = vPos.xy;\n    vec3 col = vec3(0.0);\n\n";
+    shaderIR::appendStatements(glsl, slowIR);
+    for (size_t k = 0; k < out.slowElements.size(); ++k) {
+      const int i = out.slowElements[k];
+      bool hasVal = false, hasCol = false;
+      for (const shaderIR::Stmt &s : slowIR.stmts) {
+        hasVal |= s.op != shaderIR::StmtOp::Comment && shaderIR::sameStorage(s.target, Var::val(i));
+        hasCol |= s.op != shaderIR::StmtOp::Comment && shaderIR::sameStorage(s.target, Var::layerCol(i));
+      }
+      glsl += "    slow_" + std::to_string(k) + " = vec4(";
+      glsl += hasCol ? "layerCol_" + std::to_string(i) : std::string("vec3(0.0)");
+      glsl += ", ";
+      glsl += hasVal ? "val_" + std::to_string(i) : std::string("0.0");
+      glsl += ");\n";
+    }
+    glsl += "}\n";
+  }
+  out.slowVertex = slowPassVertex(options.extent);
+
+  // fast pass: slow layers become fetches, their chains drop out
+  for (size_t k = out.slowElements.size(); k-- > 0;) {
+    detail::sampleBakedLayer(ir, out.slowElements[k], out.samplers[k], options.extent);
+  }
+  optimizer.run(ir);
+  out.fast = estimateCost(ir, elementCount, {}, options.quality);
+  out.fastGlsl = printShaderCode(tmpl, ir, options.quality, out.samplers);
+  return out;
+}
+
+} // namespace shaderLib
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../shaderLib/ShaderIR.hpp"
+
+// === IR optimisation: constant folding + dead code elimination === //
+// Runs over a built Program before it's printed:
+//   1. forward: fold constant arithmetic / builtins, propagate variables that
+//      were assigned a constant, and simplify identities (x*1, x/1, x+0,
+//      mix(a, b, 0) -> a, mix(a, b, 1) -> b, ...)
+//   2. drop no-op statements: comments, x = x, x *= 1, x += 0
+//   3. backward: remove statements whose result is never read before main()
+//      hands col to fragColor - so an element whose mask folds to 0 loses its
+//      whole uv_i / val_i / layerCol_i chain
+// Helper calls are never folded (they're GLSL text), but they're dropped with
+// the rest of a dead chain.
+
+namespace shaderIR {
+
+// ops = every non-leaf expression node as printed (each +, *, call, ...)
+struct InstructionCount {
+  size_t statements = 0;
+  size_t ops = 0;
+  size_t helperCalls = 0;
+};
+
+struct OptimizeStats {
+  InstructionCount before;
+  InstructionCount after;
+};
+
+namespace detail {
+
+inline void countExpr(const Program &p, ExprId id, InstructionCount &c) {
+  const Expr &e = p.exprs[id];
+  switch (e.op) {
+  case Op::Const:
+  case Op::Var:
+  case Op::Uniform:
+  case Op::Palette: return;
+  case Op::Call:
+    if (e.fn == Fn::Helper) ++c.helperCalls;
+    break;
+  default: break;
+  }
+  ++c.ops;
+  for (int i = 0; i < e.argc; ++i) countExpr(p, e.args[i], c);
+}
+
+} // namespace detail
+
+inline InstructionCount countInstructions(const Program &p) {
+  InstructionCount c;
+  for (const Stmt &s : p.stmts) {
+    if (s.op == StmtOp::Comment) continue;
+    ++c.statements;
+    if (s.op == StmtOp::AddAssign || s.op == StmtOp::MulAssign) ++c.ops;
+    detail::countExpr(p, s.value, c);
+    if (s.guarded()) {
+      ++c.ops; // the compare
+      detail::countExpr(p, s.guard, c);
+    }
+  }
+  return c;
+}
+
+/**
+ * @brief Reusable optimiser - keeps its scratch tables between runs.
+ */
+class Optimizer {
+public:
+  // uvLiveOut: something after p still reads uv (p is one element of a larger
+  // shader, see ShaderIncremental.hpp). col is treated as live, unless liveOut
+  // names what is read after p instead (an offscreen pass writing element
+  // locals, ShaderMultiRate.hpp)
+  OptimizeStats run(Program &p, bool uvLiveOut = false, const std::vector<Var> *liveOut = nullptr) {
+    OptimizeStats stats;
+    stats.before = countInstructions(p);
+    resize(p);
+    foldForward(p);
+    eliminateDead(p, uvLiveOut, liveOut);
+    fixDeclarations(p);
+    pruneHelpers(p);
+    stats.after = countInstructions(p);
+    return stats;
+  }
+
+  // after run(): whether the optimised program reads the uv it was handed
+  bool uvLiveIn() const { return mUVLiveIn; }
+
+private:
+  static constexpr ExprId kNone = 0xFFFFFFFFu;
+  static int slot(const Var &v) { return varSlot(v); }
+
+  void resize(const Program &p) {
+    int maxElement = -1;
+    for (const Stmt &s : p.stmts) maxElement = std::max<int>(maxElement, s.element);
+    mSlots = varSlotCount(maxElement);
+    mConstOf.assign(mSlots, kNone);
+    mLive.assign(mSlots, 0);
+    mDeclared.assign(mSlots, 0);
+  }
+
+  // --- helpers for reading constants ---
+  static bool isConst(const Program &p, ExprId id, double &v) {
+    const Expr &e = p.exprs[id];
+    if (e.op != Op::Const) return false;
+    v = e.value;
+    return true;
+  }
+  // scalar constant c, or vecN(c) / vecN(c, c, ...)
+  static bool isConstValue(const Program &p, ExprId id, double want) {
+    const Expr &e = p.exprs[id];
+    if (e.op == Op::Const) return e.value == want;
+    if (e.op == Op::Call && (e.fn == Fn::Vec2 || e.fn == Fn::Vec3) && e.argc > 0) {
+      for (int i = 0; i < e.argc; ++i) {
+        double v;
+        if (!isConst(p, e.args[i], v) || v != want) return false;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  ExprId zeroOf(Program &p, Type t) {
+    if (t == Type::Vec2) return p.call(Fn::Vec2, {p.constant(0.0)});
+    if (t == Type::Vec3) return p.call(Fn::Vec3, {p.constant(0.0)});
+    return p.constant(0.0);
+  }
+
+  // --- 1. forward folding ---
+  ExprId simplify(Program &p, ExprId id) {
+    // the same node can be shared within a statement; results only hold for
+    // the statement being folded (constants change between statements)
+    if (id < mMemoStamp.size() && mMemoStamp[id] == mStamp) return mMemo[id];
+    const ExprId out = simplifyUncached(p, id);
+    if (mMemo.size() < p.exprs.size()) {
+      mMemo.resize(p.exprs.size(), kNone);
+      mMemoStamp.resize(p.exprs.size(), 0);
+    }
+    mMemo[id] = out;
+    mMemoStamp[id] = mStamp;
+    return out;
+  }
+
+  ExprId simplifyUncached(Program &p, ExprId id) {
+    const Expr e = p.exprs[id]; // copy - p.exprs may grow below
+    switch (e.op) {
+    case Op::Const:
+    case Op::Uniform:
+    case Op::Palette: return id;
+    case Op::Var: {
+      if (e.var.component < 0) {
+        const ExprId c = mConstOf[slot(e.var)];
+        if (c != kNone) return c;
+      }
+      return id;
+    }
+    case Op::Neg: {
+      const ExprId a = simplify(p, e.args[0]);
+      double v;
+      if (isConst(p, a, v)) return p.constant(-v);
+      return a == e.args[0] ? id : p.neg(a);
+    }
+    case Op::Add:
+    case Op::Sub:
+    case Op::Mul:
+    case Op::Div: return simplifyBinary(p, id, e);
+    case Op::Call: return simplifyCall(p, id, e);
+    }
+    return id;
+  }
+
+  ExprId simplifyBinary(Program &p, ExprId id, const Expr &e) {
+    const ExprId a = simplify(p, e.args[0]);
+    const ExprId b = simplify(p, e.args[1]);
+    double va, vb;
+    const bool ca = isConst(p, a, va), cb = isConst(p, b, vb);
+    if (ca && cb) {
+      switch (e.op) {
+      case Op::Add: return p.constant(va + vb);
+      case Op::Sub: return p.constant(va - vb);
+      case Op::Mul: return p.constant(va * vb);
+      case Op::Div:
+        if (vb != 0.0) return p.constant(va / vb);
+        break;
+      default: break;
+      }
+    }
+    const Type ta = p.exprs[a].type, tb = p.exprs[b].type;
+    switch (e.op) {
+    case Op::Add:
+      if (isConstValue(p, b, 0.0) && ta == e.type) return a;
+      if (isConstValue(p, a, 0.0) && tb == e.type) return b;
+      break;
+    case Op::Sub:
+      if (isConstValue(p, b, 0.0) && ta == e.type) return a;
+      break;
+    case Op::Mul:
+      if (isConstValue(p, b, 1.0) && ta == e.type) return a;
+      if (isConstValue(p, a, 1.0) && tb == e.type) return b;
+      // x * 0 - scalars and vectors only (a zero matrix isn't worth spelling)
+      if ((isConstValue(p, a, 0.0) || isConstValue(p, b, 0.0)) && e.type != Type::Mat2 &&
+          ta != Type::Mat2 && tb != Type::Mat2)
+        return zeroOf(p, e.type);
+      break;
+    case Op::Div:
+      if (isConstValue(p, b, 1.0) && ta == e.type) return a;
+      break;
+    default: break;
+    }
+    if (a == e.args[0] && b == e.args[1]) return id;
+    switch (e.op) {
+    case Op::Add: return p.add(a, b);
+    case Op::Sub: return p.sub(a, b);
+    case Op::Mul: return p.mul(a, b);
+    default: return p.div(a, b);
+    }
+  }
+
+  ExprId simplifyCall(Program &p, ExprId id, const Expr &e) {
+    ExprId args[4];
+    double v[4];
+    bool allConst = true, changed = false;
+    for (int i = 0; i < e.argc; ++i) {
+      args[i] = simplify(p, e.args[i]);
+      changed |= args[i] != e.args[i];
+      allConst &= isConst(p, args[i], v[i]);
+    }
+
+    if (allConst && e.type == Type::Float) {
+      switch (e.fn) {
+      case Fn::Abs: return p.constant(std::fabs(v[0]));
+      case Fn::Sin: return p.constant(std::sin(v[0]));
+      case Fn::Cos: return p.constant(std::cos(v[0]));
+      case Fn::Step: return p.constant(v[1] < v[0] ? 0.0 : 1.0);
+      case Fn::Smoothstep: {
+        if (v[1] == v[0]) break;
+        double t = (v[2] - v[0]) / (v[1] - v[0]);
+        t = std::max(0.0, std::min(1.0, t));
+        return p.constant(t * t * (3.0 - 2.0 * t));
+      }
+      case Fn::Mix: return p.constant(v[0] * (1.0 - v[2]) + v[1] * v[2]);
+      case Fn::Dot: return p.constant(v[0] * v[1]);
+      default: break;
+      }
+    }
+    if (e.fn == Fn::Mix) {
+      if (isConstValue(p, args[2], 0.0)) return args[0];
+      if (isConstValue(p, args[2], 1.0) && p.exprs[args[1]].type == e.type) return args[1];
+      if (args[0] == args[1]) return args[0];
+      const Expr &a0 = p.exprs[args[0]], &a1 = p.exprs[args[1]];
+      if (a0.op == Op::Var && a1.op == Op::Var && sameVar(a0.var, a1.var)) return args[0];
+    }
+    if (!changed) return id;
+
+    Expr copy = e;
+    for (int i = 0; i < e.argc; ++i) copy.args[i] = args[i];
+    p.exprs.push_back(copy);
+    return static_cast<ExprId>(p.exprs.size() - 1);
+  }
+
+  void foldForward(Program &p) {
+    size_t out = 0;
+    for (size_t i = 0; i < p.stmts.size(); ++i) {
+      Stmt s = p.stmts[i];
+      if (s.op == StmtOp::Comment) continue; // no-op
+      ++mStamp;
+      s.value = simplify(p, s.value);
+      if (s.guarded()) {
+        s.guard = simplify(p, s.guard);
+        double g;
+        if (isConst(p, s.guard, g)) {
+          if (g >= s.guardBelow) continue; // never runs
+          s.guard = kNoGuard;              // always runs
+        }
+      }
+
+      const Expr &value = p.exprs[s.value];
+      const int target = slot(s.target);
+      bool drop = false;
+      switch (s.op) {
+      case StmtOp::AddAssign:
+        drop = isConstValue(p, s.value, 0.0);
+        break;
+      case StmtOp::MulAssign:
+        drop = isConstValue(p, s.value, 1.0);
+        if (!drop && isConstValue(p, s.value, 0.0) && storageType(s.target.kind) == Type::Float &&
+            s.target.component < 0) {
+          s.op = StmtOp::Assign; // x *= 0  ->  x = 0
+        }
+        break;
+      case StmtOp::Assign:
+        drop = value.op == Op::Var && sameVar(value.var, s.target); // x = x
+        break;
+      default: break;
+      }
+      if (drop) continue;
+
+      // remember scalars that now hold a constant, forget anything else written
+      double c;
+      if ((s.op == StmtOp::Declare || s.op == StmtOp::Assign) && s.target.component < 0 &&
+          !s.guarded() && isConst(p, s.value, c)) {
+        mConstOf[target] = s.value;
+      } else {
+        mConstOf[target] = kNone;
+      }
+      p.stmts[out++] = s;
+    }
+    p.stmts.resize(out);
+  }
+
+  // --- 3. backward liveness ---
+  void markReads(const Program &p, ExprId id) {
+    const Expr &e = p.exprs[id];
+    if (e.op == Op::Var) {
+      mLive[slot(e.var)] = 1;
+      return;
+    }
+    for (int i = 0; i < e.argc; ++i) markReads(p, e.args[i]);
+  }
+
+  void eliminateDead(Program &p, bool uvLiveOut, const std::vector<Var> *liveOut) {
+    std::fill(mLive.begin(), mLive.end(), 0);
+    mLive[slot(Var::col())] = !liveOut; // read by fragColor after the body
+    mLive[slot(Var::uv())] = uvLiveOut;
+    if (liveOut) {
+      for (const Var &v : *liveOut) {
+        if (slot(v) < mSlots) mLive[slot(v)] = 1;
+      }
+    }
+    size_t keep = p.stmts.size();
+    for (size_t i = p.stmts.size(); i-- > 0;) {
+      const Stmt &s = p.stmts[i];
+      const int target = slot(s.target);
+      if (!mLive[target]) continue; // nobody reads what this writes
+
+      // a full overwrite ends the live range, partial / compound writes read it
+      const bool fullWrite = (s.op == StmtOp::Declare || s.op == StmtOp::Assign) &&
+                             s.target.component < 0 && !s.guarded();
+      if (fullWrite) mLive[target] = 0;
+      markReads(p, s.value);
+      if (s.guarded()) markReads(p, s.guard);
+      p.stmts[--keep] = s;
+    }
+    p.stmts.erase(p.stmts.begin(), p.stmts.begin() + static_cast<std::ptrdiff_t>(keep));
+    mUVLiveIn = mLive[slot(Var::uv())] != 0;
+  }
+
+  // a removed `float val_i = ...` followed by a surviving `val_i = 0.0` has to
+  // become the declaration
+  void fixDeclarations(Program &p) {
+    std::fill(mDeclared.begin(), mDeclared.end(), 0);
+    for (Stmt &s : p.stmts) {
+      if (s.target.element < 0) continue; // uv / col are declared by main()
+      const int target = slot(s.target);
+      if (s.op == StmtOp::Assign && !mDeclared[target] && s.target.component < 0 && !s.guarded()) {
+        s.op = StmtOp::Declare;
+      }
+      mDeclared[target] = 1;
+    }
+  }
+
+  // helpers only called from removed statements don't need printing. the rest
+  // are kept in order of first surviving use, so printing elements one at a
+  // time gives the same order as printing the whole shader
+  void markHelpers(const Program &p, ExprId id) {
+    const Expr &e = p.exprs[id];
+    if (e.op == Op::Call && e.fn == Fn::Helper) {
+      if (std::find(mUsedHelpers.begin(), mUsedHelpers.end(), e.helper) == mUsedHelpers.end())
+        mUsedHelpers.push_back(e.helper);
+    }
+    for (int i = 0; i < e.argc; ++i) markHelpers(p, e.args[i]);
+  }
+
+  void pruneHelpers(Program &p) {
+    mUsedHelpers.clear();
+    for (const Stmt &s : p.stmts) {
+      if (s.op == StmtOp::Comment) continue;
+      markHelpers(p, s.value);
+      if (s.guarded()) markHelpers(p, s.guard);
+    }
+    p.helpers.assign(mUsedHelpers.begin(), mUsedHelpers.end());
+  }
+
+  int mSlots = 0;
+  std::vector<ExprId> mConstOf;
+  std::vector<uint8_t> mLive;
+  std::vector<uint8_t> mDeclared;
+  std::vector<const HelperDef *> mUsedHelpers;
+  std::vector<ExprId> mMemo;
+  std::vector<uint32_t> mMemoStamp;
+  uint32_t mStamp = 0;
+  bool mUVLiveIn = false;
+};
+
+// one-shot convenience
+inline OptimizeStats optimize(Program &p) {
+  Optimizer opt;
+  return opt.run(p);
+}
+
+} // namespace shaderIR
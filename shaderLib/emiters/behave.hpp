@@ -1,20 +1,23 @@
 #pragma once
 
 
-#include "../../shaderLib/shaderLibUtility.hpp"
-#include <iomanip>
+#include "../../shaderLib/ShaderLibUtility.hpp"
+#include "../../shaderLib/ShaderIR.hpp"
+#include <charconv>
 
   
 namespace behave {
 
   using ShaderElement = shaderUtility::ShaderElement;
-  using Emitted       = shaderUtility::Emitted;
+  using Program       = shaderIR::Program;
+  using Var           = shaderIR::Var;
+  using shaderIR::ExprId;
+  using shaderIR::Fn;
 
   inline std::string glslFloat(double x) {
-  std::ostringstream ss;
-  ss.setf(std::ios::fixed);
-  ss << std::setprecision(6) << x; // e.g., 2.000000
-  return ss.str();
+  char buf[64];
+  const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::fixed, 6);
+  return std::string(buf, r.ptr); // e.g., 2.000000
 }
 
 // One function, two phases
@@ -29,26 +32,79 @@ enum class BehaviorPhase { UV, VAL };
 //                    tmpl.globalUniforms.end(), name) != tmpl.globalUniforms.end();
 // }
 
-// main behavior function 
-inline Emitted emitElementBehavior(const ShaderElement& element,
-                                   int elementIndex,
-                                   BehaviorPhase phase) {
-  Emitted out;
+// what a behavior is handed: the element's standard variables + the driving
+// expression (uniform * speed), built once and shared by every use
+struct BehaviorArgs {
+  ExprId drive; ///< (uniform * speed)
+  Var val;      ///< val_i
+  Var uvi;      ///< uv_i
+  int elementIndex;
+};
+
+struct BehaviorEntry {
+  const char *name;
+  BehaviorPhase phase; ///< UV behaviors run BEFORE structure, VAL behaviors AFTER
+  void (*emit)(Program &ir, const BehaviorArgs &a);
+};
+
+// BEHAVIOR LIBRARY (union of both phases)
+inline const shaderUtility::EmitterRegistry<BehaviorEntry> &registry() {
+  static const shaderUtility::EmitterRegistry<BehaviorEntry> lib = {
+      // === UV behaviors (modify uv_i) ===
+      {"scrollUV", BehaviorPhase::UV, [](Program &ir, const BehaviorArgs &a) {
+         // scroll rate scales with (uniform * speed)
+         ir.addAssign(a.uvi, ir.mul(ir.call(Fn::Vec2, {ir.constant(0.1), ir.constant(0.0)}), a.drive));
+       }},
+      {"rotateUV", BehaviorPhase::UV, [](Program &ir, const BehaviorArgs &a) {
+         // rotation angle scales with (uniform * speed)
+         const Var an = Var::local(shaderIR::VarKind::RotAngle, a.elementIndex);
+         const Var c  = Var::local(shaderIR::VarKind::RotCos, a.elementIndex);
+         const Var s  = Var::local(shaderIR::VarKind::RotSin, a.elementIndex);
+         ir.declare(an, ir.mul(a.drive, ir.constant(0.5)));
+         ir.declare(c, ir.call(Fn::Cos, {ir.var(an)}));
+         ir.declare(s, ir.call(Fn::Sin, {ir.var(an)}));
+         ir.assign(a.uvi, ir.mul(ir.call(Fn::Mat2, {ir.var(c), ir.neg(ir.var(s)), ir.var(s), ir.var(c)}),
+                                 ir.var(a.uvi)));
+       }},
+      // === Value behaviors (modify val_i) ===
+      {"scaleWith", BehaviorPhase::VAL, [](Program &ir, const BehaviorArgs &a) {
+         // scales the structure response by a (uniform * speed)
+         ir.mulAssign(a.val, a.drive);
+       }},
+      {"sineMod", BehaviorPhase::VAL, [](Program &ir, const BehaviorArgs &a) {
+         // phase driven by (uniform * speed); spatial term unchanged
+         ir.assign(a.val, ir.add(ir.constant(0.5),
+                                 ir.mul(ir.constant(0.5),
+                                        ir.call(Fn::Sin, {ir.add(a.drive, ir.mul(ir.constant(6.28318), ir.var(a.val)))}))));
+       }},
+      {"threshWith", BehaviorPhase::VAL, [](Program &ir, const BehaviorArgs &a) {
+         // threshold moves with (uniform * speed)
+         ir.mulAssign(a.val, ir.call(Fn::Step, {a.drive, ir.var(a.val)}));
+       }},
+  };
+  return lib;
+}
 
-  const std::string u   = element.behaviorUniform;
-  const std::string val = "val_" + std::to_string(elementIndex);   // <-- standard name
-  const std::string uvi = "uv_"  + std::to_string(elementIndex);   // uv specific to this element - important for element size and placement
-  const std::string sp  = glslFloat(element.speed);                 // SPEED multiplier as a GLSL literal
+// main behavior function - behaviorId already resolved through registry()
+// speedArray: read the speed from this GLSL expression (a uniform array
+// element in a fused loop, ShaderFused.hpp) instead of element.speed
+inline void emitElementBehavior(Program &ir,
+                                const ShaderElement& element,
+                                int elementIndex,
+                                BehaviorPhase phase,
+                                int behaviorId,
+                                std::string_view speedArray = {}) {
+  const std::string &u = element.behaviorUniform;
 
   // No behavior? No-op.
-  if (shaderUtility::isBlank(element.elementBehavior)) return out;
+  if (shaderUtility::isBlank(element.elementBehavior)) return;
 
   // Require a uniform for all current behaviors
   if (shaderUtility::isBlank(u)) {
     std::cerr << "ERROR: Element " << elementIndex
               << " behaviorUniform is empty while elementBehavior is '"
               << element.elementBehavior << "'" << std::endl;
-    return out;
+    return;
   }
   // Optional but helpful: ensure uniform exists in template
 //   if (!hasUniform(tmpl, u)) {
@@ -57,69 +113,32 @@ inline Emitted emitElementBehavior(const ShaderElement& element,
 //     return out;
 //   }
 
-  // Recognized behaviors (union of both phases)
-  const bool known =
-      element.elementBehavior == "scaleWith" ||
-      element.elementBehavior == "sineMod"   ||
-      element.elementBehavior == "rotateUV"  ||
-      element.elementBehavior == "scrollUV"  ||
-      element.elementBehavior == "threshWith";
-
-  if (!known) {
+  if (behaviorId == shaderUtility::EmitterRegistry<BehaviorEntry>::kUnknown) {
     std::cerr << "ERROR: Element " << elementIndex
               << " elementBehavior '" << element.elementBehavior
               << "' not recognized" << std::endl;
-    return out;
+    return;
   }
 
-  // === UV behaviors (run BEFORE structure; modify uv_i) ===
-  if (phase == BehaviorPhase::UV) {
-    if (element.elementBehavior == "scrollUV") {
-      // scroll rate scales with (uniform * speed)
-      out.calls += "// behavior: scrollUV(" + u + ") * speed=" + sp + "\n";
-      out.calls += uvi + " += vec2(0.1, 0.0) * (" + u + " * " + sp + ");\n";
-    } else if (element.elementBehavior == "rotateUV") {
-      // rotation angle scales with (uniform * speed)
-      const std::string idx = std::to_string(elementIndex);
-      const std::string a   = "a_" + idx;
-      const std::string c   = "c_" + idx;
-      const std::string s   = "s_" + idx;
-      out.calls += "// behavior: rotateUV(" + u + ") * speed=" + sp + "\n";
-      out.calls += "float " + a + " = (" + u + " * " + sp + ") * 0.5;\n";
-      out.calls += "float " + c + " = cos(" + a + "), " + s + " = sin(" + a + ");\n";
-      out.calls += uvi + " = mat2(" + c + ", -" + s + ", " + s + ", " + c + ") * " + uvi + ";\n";
-    }
-    // Value-only behaviors are ignored in this phase.
-    return out;
-  }
+  // behaviors belonging to the other phase are ignored here
+  const BehaviorEntry &entry = registry()[behaviorId];
+  if (entry.phase != phase) return;
 
-  // === Value behaviors (run AFTER structure; modify val_i) ===
-  if (phase == BehaviorPhase::VAL) {
-    if (element.elementBehavior == "scaleWith") {
-      // scales the structure response by a (uniform * speed)
-      out.calls += "// behavior: scaleWith(" + u + ") * speed=" + sp + "\n";
-      out.calls += val + " *= (" + u + " * " + sp + ");\n";
-    } else if (element.elementBehavior == "sineMod") {
-      // phase driven by (uniform * speed); spatial term unchanged
-      out.calls += "// behavior: sineMod(" + u + ") * speed=" + sp + "\n";
-      out.calls += val + " = 0.5 + 0.5 * sin((" + u + " * " + sp + ") + 6.28318 * " + val + ");\n";
-    } else if (element.elementBehavior == "threshWith") {
-      // threshold moves with (uniform * speed)
-      out.calls += "// behavior: threshWith(" + u + ") * speed=" + sp + "\n";
-      out.calls += val + " *= step((" + u + " * " + sp + "), " + val + ");\n";
-    }
-    // UV-only behaviors are ignored in this phase.
-    return out;
-  }
+  char literal[64];                               // SPEED multiplier as a GLSL literal
+  const std::string_view sp = speedArray.empty() ? shaderIR::formatFloat(literal, element.speed) : speedArray;
+  ir.comment({"behavior: ", entry.name, "(", u, ") * speed=", sp});
 
-  return out;
+  const ExprId speed = speedArray.empty() ? ir.constant(element.speed) : ir.symbol(speedArray);
+  const ExprId drive = ir.mul(ir.uniform(u), speed);
+  entry.emit(ir, BehaviorArgs{drive, Var::val(elementIndex), Var::elementUV(elementIndex), elementIndex});
 }
 
-                         
-
-
-
-
-
+inline void emitElementBehavior(Program &ir,
+                                const ShaderElement& element,
+                                int elementIndex,
+                                BehaviorPhase phase) {
+  emitElementBehavior(ir, element, elementIndex, phase,
+                      registry().id(element.elementBehavior));
+}
 
 }
\ No newline at end of file
@@ -1,56 +1,63 @@
 #pragma once
 
 
-#include "../../shaderLib/shaderLibUtility.hpp"
+#include "../../shaderLib/ShaderLibUtility.hpp"
+#include "../../shaderLib/ShaderIR.hpp"
+
 
-  
 
 namespace color {
 
   using ShaderElement = shaderUtility::ShaderElement;
-  using Emitted       = shaderUtility::Emitted;
-
-  inline Emitted emitElementColor(const ShaderElement &element, int elementIndex) {
-  Emitted out;
+  using Program       = shaderIR::Program;
+  using Var           = shaderIR::Var;
+  using shaderIR::Fn;
+
+  // which palette entries the element's val_i mixes between (expects color0, color1, color2)
+  struct ColorEntry {
+    const char *name;
+    const char *comment;
+    int from; ///< palette index, -1 -> grayscale vec3(val)
+    int to;
+  };
+
+  // COLOR LIBRARY
+  inline const shaderUtility::EmitterRegistry<ColorEntry> &registry() {
+    static const shaderUtility::EmitterRegistry<ColorEntry> lib = {
+        {"primary", "color usage: primary -> layerCol_i", 0, 1},
+        {"secondary", "color usage: secondary -> layerCol_i", 1, 2},
+        {"default", "color usage: default (grayscale) -> layerCol_i", -1, -1},
+    };
+    return lib;
+  }
 
-  const std::string idx  = std::to_string(elementIndex);
-  const std::string val  = "val_" + idx;            // scalar from structure
-  const std::string dest = "layerCol_" + idx;       // per-element color for layering
+  inline void emitElementColor(Program &ir, const ShaderElement &element, int elementIndex, int colorId) {
+  const Var val  = Var::val(elementIndex);       // scalar from structure
+  const Var dest = Var::layerCol(elementIndex);  // per-element color for layering
 
   if (shaderUtility::isBlank(element.colorUsage)) {
     std::cerr << "ERROR: Element " << elementIndex << " colorUsage is empty " << std::endl;
   }
 
-  const bool known =
-      element.colorUsage == "primary"   ||
-      element.colorUsage == "secondary" ||
-      element.colorUsage == "default";
-
-  if (!known) {
+  if (colorId == shaderUtility::EmitterRegistry<ColorEntry>::kUnknown) {
     std::cerr << "ERROR: Inputted colorUsage " << elementIndex
               << " name does not match library" << std::endl;
+    colorId = registry().id("default"); // unknown usages fall back to grayscale
   }
 
-  // Emit color based on usage (expects uniforms color0, color1, color2)
-  if (element.colorUsage == "primary") {
-    out.calls +=
-      "// color usage: primary -> layerCol_i\n"
-      "vec3 " + dest + " = mix(color0, color1, " + val + ");\n";
-  }
-  else if (element.colorUsage == "secondary") {
-    out.calls +=
-      "// color usage: secondary -> layerCol_i\n"
-      "vec3 " + dest + " = mix(color1, color2, " + val + ");\n";
+  const ColorEntry &entry = registry()[colorId];
+  ir.comment({entry.comment});
+  if (entry.from >= 0) {
+    ir.declare(dest, ir.call(Fn::Mix, {ir.palette(entry.from), ir.palette(entry.to), ir.var(val)}));
+  } else {
+    ir.declare(dest, ir.call(Fn::Vec3, {ir.var(val)}));
   }
-  else { // default
-    out.calls +=
-      "// color usage: default (grayscale) -> layerCol_i\n"
-      "vec3 " + dest + " = vec3(" + val + ");\n";
-  }
-
-  return out;
 }
 
+  inline void emitElementColor(Program &ir, const ShaderElement &element, int elementIndex) {
+    emitElementColor(ir, element, elementIndex, registry().id(element.colorUsage));
+  }
 
 
-}
\ No newline at end of file
+
+}
@@ -1,71 +1,88 @@
 #pragma once
 
-#include "../../shaderLib/shaderLibUtility.hpp"
+#include "../../shaderLib/ShaderLibUtility.hpp"
+#include "../../shaderLib/ShaderIR.hpp"
+
 
-  
 
 namespace layering {
 
   using ShaderElement = shaderUtility::ShaderElement;
-  using Emitted       = shaderUtility::Emitted;
-
-  inline Emitted emitElementLayering(const ShaderElement& element, int elementIndex) {
-  Emitted out;
+  using Program       = shaderIR::Program;
+  using Var           = shaderIR::Var;
+  using shaderIR::ExprId;
+  using shaderIR::Fn;
+
+  // overlay blend. one shared helper per shader
+  inline const shaderIR::HelperDef blendOverlay = {
+      "blendOverlay",
+      "",
+      "(vec3 b, vec3 s) {\n"
+      "  vec3 lo = 2.0 * b * s;\n"
+      "  vec3 hi = 1.0 - 2.0 * (1.0 - b) * (1.0 - s);\n"
+      "  return mix(lo, hi, step(0.5, b));\n"
+      "}\n",
+      shaderIR::Type::Vec3,
+      {12, 0, 0}};
+
+  // each mode builds the blended color from accum (col) and src (layerCol_i);
+  // the emitter then mixes it into col by the mask (val_i)
+  struct LayeringEntry {
+    const char *name;
+    ExprId (*blend)(Program &ir, const Var &accum, const Var &src);
+  };
+
+  // LAYERING LIBRARY
+  inline const shaderUtility::EmitterRegistry<LayeringEntry> &registry() {
+    static const shaderUtility::EmitterRegistry<LayeringEntry> lib = {
+        {"add", [](Program &ir, const Var &accum, const Var &src) {
+           return ir.add(ir.var(accum), ir.var(src));
+         }},
+        {"blend", [](Program &ir, const Var &, const Var &src) {
+           return ir.var(src);
+         }},
+        {"screen", [](Program &ir, const Var &accum, const Var &src) {
+           // 1.0 - (1.0 - col)*(1.0 - src)
+           return ir.sub(ir.constant(1.0),
+                         ir.mul(ir.sub(ir.constant(1.0), ir.var(accum)),
+                                ir.sub(ir.constant(1.0), ir.var(src))));
+         }},
+        {"multiply", [](Program &ir, const Var &accum, const Var &src) {
+           return ir.mul(ir.var(accum), ir.var(src));
+         }},
+        {"overlay", [](Program &ir, const Var &accum, const Var &src) {
+           return ir.call(blendOverlay, {ir.var(accum), ir.var(src)});
+         }},
+    };
+    return lib;
+  }
 
-  const std::string idx   = std::to_string(elementIndex);
-  const std::string mask  = "val_" + idx;        // alpha/mask from structure
-  const std::string src   = "layerCol_" + idx;   // per-element color
-  const std::string accum = "col";               // global accumulator
+  inline void emitElementLayering(Program &ir, const ShaderElement& element, int elementIndex, int layeringId) {
+  const Var mask  = Var::val(elementIndex);       // alpha/mask from structure
+  const Var src   = Var::layerCol(elementIndex);  // per-element color
+  const Var accum = Var::col();                   // global accumulator
 
   if (shaderUtility::isBlank(element.layering)) {
     std::cerr << "ERROR: Element " << elementIndex << " layering is empty" << std::endl;
   }
 
-  // Valid layering modes
-  const bool known =
-      element.layering == "add"     ||
-      element.layering == "blend"   ||
-      element.layering == "screen"  ||
-      element.layering == "multiply"||
-      element.layering == "overlay";
-
-  if (!known) {
+  if (layeringId == shaderUtility::EmitterRegistry<LayeringEntry>::kUnknown) {
     std::cerr << "ERROR: Element " << elementIndex
               << " layering mode \"" << element.layering
               << "\" not recognized" << std::endl;
+    return;
   }
 
-  // Per-index overlay helper (so functions don’t clash)
-  if (element.layering == "overlay") {
-    out.helpers +=
-      "vec3 blendOverlay_" + idx + "(vec3 b, vec3 s) {\n"
-      "  vec3 lo = 2.0 * b * s;\n"
-      "  vec3 hi = 1.0 - 2.0 * (1.0 - b) * (1.0 - s);\n"
-      "  return mix(lo, hi, step(0.5, b));\n"
-      "}\n";
-  }
+  // composite src into col based on layering mode
+  const ExprId blended = registry()[layeringId].blend(ir, accum, src);
+  ir.assign(accum, ir.call(Fn::Mix, {ir.var(accum), blended, ir.var(mask)}));
+}
 
-  // Calls: composite src into col based on layering mode
-  if (element.layering == "add") {
-    out.calls += accum + " = mix(" + accum + ", " + accum + " + " + src + ", " + mask + ");\n";
-  }
-  else if (element.layering == "blend") {
-    out.calls += accum + " = mix(" + accum + ", " + src + ", " + mask + ");\n";
-  }
-  else if (element.layering == "screen") {
-    out.calls += accum + " = mix(" + accum + ", 1.0 - (1.0 - " + accum + ")*(1.0 - " + src + "), " + mask + ");\n";
-  }
-  else if (element.layering == "multiply") {
-    out.calls += accum + " = mix(" + accum + ", " + accum + " * " + src + ", " + mask + ");\n";
+  inline void emitElementLayering(Program &ir, const ShaderElement& element, int elementIndex) {
+    emitElementLayering(ir, element, elementIndex, registry().id(element.layering));
   }
-  else if (element.layering == "overlay") {
-    out.calls += accum + " = mix(" + accum + ", blendOverlay_" + idx + "(" + accum + ", " + src + "), " + mask + ");\n";
-  }
-
-  return out;
-}
 
 
 
 
-}
\ No newline at end of file
+}
@@ -2,342 +2,327 @@
 
 #include <algorithm>
 // #include <opencv2/core.hpp>
-#include "../../shaderLib/shaderLibUtility.hpp"
+#include "../../shaderLib/ShaderLibUtility.hpp"
+#include "../../shaderLib/ShaderIR.hpp"
 
   
 
 namespace structures {
 
   using ShaderElement = shaderUtility::ShaderElement;
-  using Emitted       = shaderUtility::Emitted;
+  using Program       = shaderIR::Program;
+  using Var           = shaderIR::Var;
 
 
 
 
 // THE FOLLOWING FUNCTIONS RETRIEVE STRINGS FOR COMPONENETS OF AN ELEMENT ////
-inline Emitted emitElementStructure(const ShaderElement &element, int elementIndex) {
-  Emitted emmitedOutput;
 
-  std::string functionName =
-        element.structure + "_" + std::to_string(elementIndex);
-  std::string val = "val_" + std::to_string(elementIndex);  // <-- standard name
-  std::string uvi = "uv_" + std::to_string(elementIndex);   // uv specific to this element - important for element size and placement
-  
+// One library entry per structure: a helper printed as
+//   preamble + "float <name>" + body
+// It's identical for every element index, so the generator only keeps one
+// copy per shader no matter how many elements use the structure.
+// The cost {alu, transcendental, loop iterations} is per pixel, worst case.
+// Expensive structures also have cheaper tiers picked by the QUALITY define
+// (0 low, 1 medium, 2 full - see GeneratorOptions::quality); their costs follow
+// as {QUALITY 0, QUALITY 1}. Lower tiers keep the look: fewer octaves/
+// iterations/off-screen seeds, a 2x2 voronoi search, no per-wave cos/sin.
+// cheaper: what the budget gate swaps in when a template is too expensive
+// (ShaderCost.hpp) - something that reads similarly on screen.
+// footprint: radius (in the structure's own p space) past which the value is
+// known without running it - `outside`, a float the preamble #defines. The
+// element then only calls the structure inside its footprint; placement and
+// size carry over since the test is on uv_i. Leave it 0 for structures that
+// are unbounded by design (most of them: waves, noise, SDFs that keep growing).
+struct StructureEntry : shaderIR::HelperDef {
+  const char *cheaper = nullptr;
+  float footprint = 0.0f;
+  const char *outside = nullptr;
+};
+
+// STRUCTURE LIBRARY - add new structures here, nothing else needs touching
+inline const shaderUtility::EmitterRegistry<StructureEntry> &registry() {
+  static const shaderUtility::EmitterRegistry<StructureEntry> lib = {
+      {{"waveGrid",
+       "// below is a wave grid function\n",
+       "(vec2 p) {\n"
+       "  return sin(p.x + sin(p.y * 2.0) + sin(p.y * 0.43));\n"
+       "}\n", shaderIR::Type::Float, {6, 3, 0}}, nullptr},
+      {{"noiseGrid",
+       "// Noise-based grid (pseudo-random)\n",
+       "(vec2 p) {\n"
+       "  return fract(sin(dot(p ,vec2(12.9898,78.233))) * 43758.5453);\n"
+       "}\n", shaderIR::Type::Float, {5, 1, 0}}, nullptr},
+      {{"circleField",
+       "// Circle field function\n",
+       "(vec2 p) {\n"
+       "  return length(p) - 0.5;\n"
+       "}\n", shaderIR::Type::Float, {3, 1, 0}}, nullptr},
+      {{"blob",
+       "// Organic blob shape with time-based wobble\n",
+       "(vec2 p) {\n"
+       "  float r = 0.5 + 0.1*sin(u_time + p.x*10.0) * cos(p.y*10.0);\n"
+       "  return length(p) - r;\n"
+       "}\n", shaderIR::Type::Float, {8, 3, 0}}, nullptr},
+      {{"superformula",
+       "// Superformula-based shape\n",
+       "(vec2 p) {\n"
+       "  float m = 6.0;\n"
+       "  float n1 = 0.3;\n"
+       "  float n2 = 1.7;\n"
+       "  float n3 = 1.7;\n"
+       "  float a = 1.0, b = 1.0;\n"
+       "  float phi = atan(p.y, p.x);\n"
+       "  float r = pow(pow(abs(cos(m*phi/4.0)/a), n2) +\n"
+       "                pow(abs(sin(m*phi/4.0)/b), n3), -1.0/n1);\n"
+       "  return length(p) - r;\n"
+       "}\n", shaderIR::Type::Float, {14, 7, 0}}, "star"},
+      {{"lissajous",
+       "// Lissajous curve pattern\n",
+       "(vec2 p) {\n"
+       "  float a = 3.0, b = 2.0;\n"
+       "  float delta = PI/2.0;\n"
+       "  return sin(a*p.x + delta) - sin(b*p.y);\n"
+       "}\n", shaderIR::Type::Float, {5, 2, 0}}, nullptr},
+      {{"lorenzAttractor",
+       "// Lorenz-like attractor projection\n",
+       "(vec2 p) {\n"
+       "  float sigma = 10.0;\n"
+       "  float rho = 28.0;\n"
+       "  float beta = 8.0/3.0;\n"
+       "  vec3 v = vec3(p, 0.1);\n"
+       "  for (int i = 0; i < 10; i++) {\n"
+       "    vec3 dv;\n"
+       "    dv.x = sigma * (v.y - v.x);\n"
+       "    dv.y = v.x * (rho - v.z) - v.y;\n"
+       "    dv.z = v.x * v.y - beta * v.z;\n"
+       "    v += 0.01 * dv;\n"
+       "  }\n"
+       "  return length(v.xy);\n"
+       "}\n", shaderIR::Type::Float, {104, 1, 10}}, "lissajous"},
+      {{"star",
+       "// Star polygon pattern\n",
+       "(vec2 p) {\n"
+       "  float a = atan(p.y,p.x);\n"
+       "  float r = cos(5.0*a) * 0.5 + 0.5;\n"
+       "  return length(p) - r;\n"
+       "}\n", shaderIR::Type::Float, {5, 3, 0}}, nullptr},
+      {{"mandalaRadial",
+       "// Mandala-like radial kaleidoscope\n",
+       "(vec2 p) {\n"
+       "  float sectors = 10.0;\n"
+       "  float a = atan(p.y, p.x);\n"
+       "  float r = length(p);\n"
+       "  // fold angle into wedge and mirror for kaleidoscope\n"
+       "  float wedge = TWO_PI / sectors;\n"
+       "  a = mod(a, wedge);\n"
+       "  a = abs(a - wedge * 0.5);\n"
+       "  // ring pattern + angular sin modulation\n"
+       "  float ring = 0.5 + 0.5 * sin(12.0 * r - u_time * 0.6);\n"
+       "  float petals = 0.5 + 0.5 * sin(8.0 * a + r * 6.0);\n"
+       "  return (ring * petals) - 0.5; // signed-ish value\n"
+       "}\n", shaderIR::Type::Float, {16, 4, 0}}, nullptr},
+      {{"quasicrystal",
+       "// Quasicrystal from multiple rotated cos waves\n",
+       "(vec2 p) {\n"
+       "  const int N = 7; // number of directions\n"
+       "  float sum = 0.0;\n"
+       "#if QUALITY >= 2\n"
+       "  for (int i = 0; i < N; i++) {\n"
+       "    float ang = (float(i) / float(N)) * PI; // half rotations avoid duplicates\n"
+       "    vec2 dir = vec2(cos(ang), sin(ang));\n"
+       "    sum += cos(dot(p * 6.0, dir) + u_time * 0.2);\n"
+       "  }\n"
+       "#else\n"
+       "  // same directions, stepped by a fixed PI/N rotation instead of cos/sin\n"
+       "  vec2 dir = vec2(1.0, 0.0);\n"
+       "  for (int i = 0; i < N; i++) {\n"
+       "    sum += cos(dot(p * 6.0, dir) + u_time * 0.2);\n"
+       "    dir = vec2(dir.x * 0.900969 - dir.y * 0.433884, dir.x * 0.433884 + dir.y * 0.900969);\n"
+       "  }\n"
+       "#endif\n"
+       "  sum /= float(N);\n"
+       "  return sum; // in [-1,1]\n"
+       "}\n", shaderIR::Type::Float, {60, 21, 7}, {{84, 7, 7}, {84, 7, 7}}}, "waveGrid"},
+      {{"voronoi",
+       "// Voronoi / Worley F1 distance (cellular)\n",
+       "(vec2 p) {\n"
+       "  vec2 g = floor(p * 4.0);\n"
+       "  vec2 f = fract(p * 4.0);\n"
+       "  float d = 1e9;\n"
+       "#if QUALITY >= 2\n"
+       "  for (int j = -1; j <= 1; j++) {\n"
+       "    for (int i = -1; i <= 1; i++) {\n"
+       "      vec2 o = vec2(i, j);\n"
+       "#else\n"
+       "  // 2x2: only the neighbours on the side of the closest cell edges\n"
+       "  vec2 b = step(0.5, f) - 1.0;\n"
+       "  for (int j = 0; j <= 1; j++) {\n"
+       "    for (int i = 0; i <= 1; i++) {\n"
+       "      vec2 o = b + vec2(i, j);\n"
+       "#endif\n"
+       "      // hash: pseudo-random feature point inside cell\n"
+       "      float n = fract(sin(dot(g + o, vec2(127.1, 311.7))) * 43758.5453);\n"
+       "      float m = fract(sin(dot(g + o, vec2(269.5, 183.3))) * 43758.5453);\n"
+       "      vec2 r = o + vec2(n, m) - f;\n"
+       "      d = min(d, dot(r, r));\n"
+       "    }\n"
+       "  }\n"
+       "  return 1.0 - sqrt(d); // brighter at cell centers\n"
+       "}\n", shaderIR::Type::Float, {150, 19, 9}, {{72, 9, 4}, {72, 9, 4}}}, "circleField"},
+      {{"roseCurve",
+       "// Rose (rhodonea) curve SDF-ish\n",
+       "(vec2 p) {\n"
+       "  float k = 7.0; // petals (odd=k, even=2k)\n"
+       "  float a = atan(p.y, p.x);\n"
+       "  float r = length(p);\n"
+       "  float target = 0.6 * abs(cos(k * a));\n"
+       "  return (r - target); // near 0 on the curve\n"
+       "}\n", shaderIR::Type::Float, {6, 3, 0}}, nullptr},
+      {{"superellipse",
+       "// Superellipse (squircle/rounded-rect family)\n",
+       "(vec2 p) {\n"
+       "  float n = 4.0 + 2.0 * sin(u_time * 0.4); // exponent animates\n"
+       "  vec2 a = vec2(0.7);\n"
+       "  float v = pow(abs(p.x / a.x), n) + pow(abs(p.y / a.y), n);\n"
+       "  return v - 1.0; // 0 at boundary\n"
+       "}\n", shaderIR::Type::Float, {10, 3, 0}}, nullptr},
+      {{"phyllotaxis",
+       "// Phyllotaxis distribution, distance to nearest seed\n"
+       "// seeds past r ~1.45 (i > ~96) only matter when the element is scaled down\n"
+       "#if QUALITY >= 2\n"
+       "#define PHYLLO_SEEDS 180\n"
+       "#elif QUALITY == 1\n"
+       "#define PHYLLO_SEEDS 128\n"
+       "#else\n"
+       "#define PHYLLO_SEEDS 96\n"
+       "#endif\n",
+       "(vec2 p) {\n"
+       "  float N = 200.0; // seed count approximation\n"
+       "  float phi = (3.14159265359 * (3.0 - sqrt(5.0))); // golden angle ~2.39996\n"
+       "  float dmin = 1e9;\n"
+       "  for (int i = 0; i < PHYLLO_SEEDS; i++) {\n"
+       "    float fi = float(i);\n"
+       "    float r = 0.015 * fi; // radial growth\n"
+       "    float a = fi * phi + u_time * 0.1;\n"
+       "    vec2 s = r * vec2(cos(a), sin(a));\n"
+       "    dmin = min(dmin, length(p - s));\n"
+       "  }\n"
+       "  return 0.5 - dmin * 3.0; // bright at seed centers\n"
+       "}\n", shaderIR::Type::Float, {1450, 540, 180}, {{770, 288, 96}, {1030, 384, 128}}}, "mandalaRadial"},
+      {{"julia",
+       "// Julia set distance-ish field\n"
+       "#if QUALITY >= 2\n"
+       "#define JULIA_ITER 60\n"
+       "#elif QUALITY == 1\n"
+       "#define JULIA_ITER 40\n"
+       "#else\n"
+       "#define JULIA_ITER 24\n"
+       "#endif\n"
+       "// |p| >= 1.5: |z1| >= 2.4^2 - |c| > 4 (|c| <= 1.51), escapes on the first iteration\n"
+       "#define JULIA_OUTSIDE (1.0 - 1.0 / float(JULIA_ITER))\n",
+       "(vec2 p) {\n"
+       "  vec2 z = p * 1.6;\n"
+       "  // time-varying parameter c\n"
+       "  vec2 c = vec2(-0.8 + 0.6 * sin(u_time * 0.23), 0.156 + 0.4 * cos(u_time * 0.19));\n"
+       "  float m2 = 0.0;\n"
+       "  float iter = 0.0;\n"
+       "  for (int i = 0; i < JULIA_ITER; i++) {\n"
+       "    z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;\n"
+       "    m2 = dot(z, z);\n"
+       "    iter += 1.0;\n"
+       "    if (m2 > 16.0) break;\n"
+       "  }\n"
+       "  // map iterations to smooth value\n"
+       "  return 1.0 - clamp(iter / float(JULIA_ITER), 0.0, 1.0);\n"
+       "}\n", shaderIR::Type::Float, {545, 2, 60}, {{221, 2, 24}, {365, 2, 40}}}, "mandalaRadial",
+       1.5f, "JULIA_OUTSIDE"},
+      {{"reactionDiffusion",
+       "// Faux reaction-diffusion: layered noise with temporal warp\n"
+       "#if QUALITY >= 2\n"
+       "#define RD_OCTAVES 5\n"
+       "#elif QUALITY == 1\n"
+       "#define RD_OCTAVES 4\n"
+       "#else\n"
+       "#define RD_OCTAVES 3\n"
+       "#endif\n"
+       "float hash(vec2 p){ return fract(sin(dot(p, vec2(127.1,311.7))) * 43758.5453); }\n"
+       "float noise(vec2 p){ vec2 i=floor(p), f=fract(p);\n"
+       "  float a=hash(i), b=hash(i+vec2(1,0)), c=hash(i+vec2(0,1)), d=hash(i+vec2(1,1));\n"
+       "  vec2 u=f*f*(3.0-2.0*f);\n"
+       "  return mix(mix(a,b,u.x), mix(c,d,u.x), u.y);\n"
+       "}\n"
+       "float fbm(vec2 p){ float s=0.0, a=0.5; for(int i=0;i<RD_OCTAVES;i++){ s+=a*noise(p); p*=2.02; a*=0.5;} return s; }\n",
+       "(vec2 p) {\n"
+       "  p *= 3.0;\n"
+       "  float t = u_time * 0.2;\n"
+       "  float u = fbm(p + vec2(t, -t));\n"
+       "  float v = fbm(rot * (p * 1.9) + vec2(-t, t));\n"
+       "  float w = fbm((p + vec2(u, v)) * 1.2);\n"
+       "  float rd = smoothstep(0.35, 0.65, w) - 0.5;\n"
+       "  return rd;\n"
+       "}\n", shaderIR::Type::Float, {620, 61, 15}, {{380, 37, 9}, {500, 49, 12}}}, "blob"},
+      {{"branchNoise",
+       "// Branch-like field via angular warping + ridged fbm\n"
+       "#if QUALITY >= 2\n"
+       "#define BRANCH_OCTAVES 5\n"
+       "#elif QUALITY == 1\n"
+       "#define BRANCH_OCTAVES 4\n"
+       "#else\n"
+       "#define BRANCH_OCTAVES 3\n"
+       "#endif\n"
+       "float n2hash(vec2 p){ return fract(sin(dot(p, vec2(41.3, 289.1))) * 43758.5453); }\n"
+       "float n2(vec2 p){ vec2 i=floor(p), f=fract(p);\n"
+       "  float a=n2hash(i), b=n2hash(i+vec2(1,0)), c=n2hash(i+vec2(0,1)), d=n2hash(i+vec2(1,1));\n"
+       "  vec2 u=f*f*(3.0-2.0*f);\n"
+       "  return mix(mix(a,b,u.x), mix(c,d,u.x), u.y);\n"
+       "}\n"
+       "float ridged(vec2 p){ float s=0.0, a=0.5; for(int i=0;i<BRANCH_OCTAVES;i++){ s+=a*(1.0-abs(2.0*n2(p)-1.0)); p*=2.03; a*=0.5;} return s; }\n",
+       "(vec2 p) {\n"
+       "  float r = length(p) + 1e-3;\n"
+       "  float a = atan(p.y, p.x);\n"
+       "  // create preferred growth directions\n"
+       "  float forks = 5.0;\n"
+       "  float dir = cos(a * forks) * 0.5 + 0.5;\n"
+       "  float bark = ridged(p * vec2(2.0, 4.0) + vec2(0.0, u_time*0.15));\n"
+       "  float veins = ridged(vec2(a * 1.5, r * 3.0));\n"
+       "  float trunk = (0.35 / r) * dir; // stronger near center and branch angles\n"
+       "  return trunk + 0.5 * veins + 0.3 * bark - 0.8;\n"
+       "}\n", shaderIR::Type::Float, {425, 43, 10}, {{265, 27, 6}, {345, 35, 8}}}, "star"},
+  };
+  return lib;
+}
+
+// emit using an id already resolved through registry() (see buildElement)
+inline void emitElementStructure(Program &ir, const ShaderElement &element, int elementIndex, int structureId) {
   if (shaderUtility::isBlank(element.structure)) {
     std::cerr << "ERROR: Element " << elementIndex << " structure is empty " << std::endl;
-
-  }
-
-   const bool known =
-       element.structure == "waveGrid"      ||
-       element.structure == "noiseGrid"     ||
-       element.structure == "circleField"   ||
-       element.structure == "blob"          ||
-       element.structure == "superformula"  ||
-       element.structure == "lissajous"     ||
-       element.structure == "lorenzAttractor" ||
-       element.structure == "star" ||
-       element.structure == "mandalaRadial"    ||
-element.structure == "quasicrystal"     ||
-element.structure == "voronoi"          ||
-element.structure == "roseCurve"        ||
-element.structure == "superellipse"     ||
-element.structure == "phyllotaxis"      ||
-element.structure == "julia"            ||
-element.structure == "reactionDiffusion"||
-element.structure == "branchNoise"
-       ;
-
-       if (!known) {
-     std::cerr << "ERROR: Inputted structure " << elementIndex << " name does not match library" << std::endl;
-  }
-  else if (element.structure == "waveGrid") {
-    
-
-    emmitedOutput.helpers +=
-        "// below is a wave grid function\n"
-        "float " +
-        functionName +
-        "(vec2 p) {\n"
-        "  return sin(p.x + sin(p.y * 2.0) + sin(p.y * 0.43));\n"
-        "}\n";
-
-    // color mix could branch on element.colorUsage *here in C++*,
-    // but the emitted GLSL is always straight-line.
-
-    emmitedOutput.calls +=
-        // "float " + functionResult + " = " + functionName +
-        // "(uv);\n"
-        // "// Below mixes color to form the wave grid\n"
-        // "col = mix(color1, color2, " +
-        // functionResult +
-        // ");\n"
-        // "// Above is the end of wavegrid color mixing\n";
-        "float " + val + " = " + functionName + "(" + uvi + ");\n";  // <- standard scalar name
-
-  }
-
-  else if (element.structure == "noiseGrid") {
-    emmitedOutput.helpers +=
-        "// Noise-based grid (pseudo-random)\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  return fract(sin(dot(p ,vec2(12.9898,78.233))) * 43758.5453);\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-  }
-
-  else if (element.structure == "circleField") {
-    emmitedOutput.helpers +=
-        "// Circle field function\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  return length(p) - 0.5;\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
   }
-
-  else if (element.structure == "blob") {
-    emmitedOutput.helpers +=
-        "// Organic blob shape with time-based wobble\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  float r = 0.5 + 0.1*sin(u_time + p.x*10.0) * cos(p.y*10.0);\n"
-        "  return length(p) - r;\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
+  if (structureId == shaderUtility::EmitterRegistry<StructureEntry>::kUnknown) {
+    std::cerr << "ERROR: Inputted structure " << elementIndex << " name does not match library" << std::endl;
+    return;
   }
 
-  else if (element.structure == "superformula") {
-    emmitedOutput.helpers +=
-        "// Superformula-based shape\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  float m = 6.0;\n"
-        "  float n1 = 0.3;\n"
-        "  float n2 = 1.7;\n"
-        "  float n3 = 1.7;\n"
-        "  float a = 1.0, b = 1.0;\n"
-        "  float phi = atan(p.y, p.x);\n"
-        "  float r = pow(pow(abs(cos(m*phi/4.0)/a), n2) +\n"
-        "                pow(abs(sin(m*phi/4.0)/b), n3), -1.0/n1);\n"
-        "  return length(p) - r;\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
+  // color mix could branch on element.colorUsage *here in C++*,
+  // but the emitted GLSL is always straight-line.
+  // float val_i = <structure>(uv_i);  <- standard scalar name
+  const StructureEntry &entry = registry()[structureId];
+  const Var val = Var::val(elementIndex);
+  const shaderIR::ExprId uvi = ir.var(Var::elementUV(elementIndex));
+  if (entry.footprint <= 0.0f) {
+    ir.declare(val, ir.call(entry, {uvi}));
+    return;
   }
-
-  else if (element.structure == "lissajous") {
-    emmitedOutput.helpers +=
-        "// Lissajous curve pattern\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  float a = 3.0, b = 2.0;\n"
-        "  float delta = PI/2.0;\n"
-        "  return sin(a*p.x + delta) - sin(b*p.y);\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-  }
-
-  else if (element.structure == "lorenzAttractor") {
-    emmitedOutput.helpers +=
-        "// Lorenz-like attractor projection\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  float sigma = 10.0;\n"
-        "  float rho = 28.0;\n"
-        "  float beta = 8.0/3.0;\n"
-        "  vec3 v = vec3(p, 0.1);\n"
-        "  for (int i = 0; i < 10; i++) {\n"
-        "    vec3 dv;\n"
-        "    dv.x = sigma * (v.y - v.x);\n"
-        "    dv.y = v.x * (rho - v.z) - v.y;\n"
-        "    dv.z = v.x * v.y - beta * v.z;\n"
-        "    v += 0.01 * dv;\n"
-        "  }\n"
-        "  return length(v.xy);\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-  }
-
-  else if (element.structure == "star") {
-    emmitedOutput.helpers +=
-        "// Star polygon pattern\n"
-        "float " + functionName + "(vec2 p) {\n"
-        "  float a = atan(p.y,p.x);\n"
-        "  float r = cos(5.0*a) * 0.5 + 0.5;\n"
-        "  return length(p) - r;\n"
-        "}\n";
-
-    emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-  }
-
-  else if (element.structure == "mandalaRadial") {
-  emmitedOutput.helpers +=
-      "// Mandala-like radial kaleidoscope\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  float sectors = 10.0;\n"
-      "  float a = atan(p.y, p.x);\n"
-      "  float r = length(p);\n"
-      "  // fold angle into wedge and mirror for kaleidoscope\n"
-      "  float wedge = TWO_PI / sectors;\n"
-      "  a = mod(a, wedge);\n"
-      "  a = abs(a - wedge * 0.5);\n"
-      "  // ring pattern + angular sin modulation\n"
-      "  float ring = 0.5 + 0.5 * sin(12.0 * r - u_time * 0.6);\n"
-      "  float petals = 0.5 + 0.5 * sin(8.0 * a + r * 6.0);\n"
-      "  return (ring * petals) - 0.5; // signed-ish value\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-
-else if (element.structure == "quasicrystal") {
-  emmitedOutput.helpers +=
-      "// Quasicrystal from multiple rotated cos waves\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  const int N = 7; // number of directions\n"
-      "  float sum = 0.0;\n"
-      "  for (int i = 0; i < N; i++) {\n"
-      "    float ang = (float(i) / float(N)) * PI; // half rotations avoid duplicates\n"
-      "    vec2 dir = vec2(cos(ang), sin(ang));\n"
-      "    sum += cos(dot(p * 6.0, dir) + u_time * 0.2);\n"
-      "  }\n"
-      "  sum /= float(N);\n"
-      "  return sum; // in [-1,1]\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-else if (element.structure == "voronoi") {
-  emmitedOutput.helpers +=
-      "// Voronoi / Worley F1 distance (cellular)\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  vec2 g = floor(p * 4.0);\n"
-      "  vec2 f = fract(p * 4.0);\n"
-      "  float d = 1e9;\n"
-      "  for (int j = -1; j <= 1; j++) {\n"
-      "    for (int i = -1; i <= 1; i++) {\n"
-      "      vec2 o = vec2(i, j);\n"
-      "      // hash: pseudo-random feature point inside cell\n"
-      "      float n = fract(sin(dot(g + o, vec2(127.1, 311.7))) * 43758.5453);\n"
-      "      float m = fract(sin(dot(g + o, vec2(269.5, 183.3))) * 43758.5453);\n"
-      "      vec2 r = o + vec2(n, m) - f;\n"
-      "      d = min(d, dot(r, r));\n"
-      "    }\n"
-      "  }\n"
-      "  return 1.0 - sqrt(d); // brighter at cell centers\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-else if (element.structure == "roseCurve") {
-  emmitedOutput.helpers +=
-      "// Rose (rhodonea) curve SDF-ish\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  float k = 7.0; // petals (odd=k, even=2k)\n"
-      "  float a = atan(p.y, p.x);\n"
-      "  float r = length(p);\n"
-      "  float target = 0.6 * abs(cos(k * a));\n"
-      "  return (r - target); // near 0 on the curve\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-else if (element.structure == "superellipse") {
-  emmitedOutput.helpers +=
-      "// Superellipse (squircle/rounded-rect family)\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  float n = 4.0 + 2.0 * sin(u_time * 0.4); // exponent animates\n"
-      "  vec2 a = vec2(0.7);\n"
-      "  float v = pow(abs(p.x / a.x), n) + pow(abs(p.y / a.y), n);\n"
-      "  return v - 1.0; // 0 at boundary\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-else if (element.structure == "phyllotaxis") {
-  emmitedOutput.helpers +=
-      "// Phyllotaxis distribution, distance to nearest seed\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  float N = 200.0; // seed count approximation\n"
-      "  float phi = (3.14159265359 * (3.0 - sqrt(5.0))); // golden angle ~2.39996\n"
-      "  float dmin = 1e9;\n"
-      "  for (int i = 0; i < 180; i++) {\n"
-      "    float fi = float(i);\n"
-      "    float r = 0.015 * fi; // radial growth\n"
-      "    float a = fi * phi + u_time * 0.1;\n"
-      "    vec2 s = r * vec2(cos(a), sin(a));\n"
-      "    dmin = min(dmin, length(p - s));\n"
-      "  }\n"
-      "  return 0.5 - dmin * 3.0; // bright at seed centers\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-else if (element.structure == "julia") {
-  emmitedOutput.helpers +=
-      "// Julia set distance-ish field\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  vec2 z = p * 1.6;\n"
-      "  // time-varying parameter c\n"
-      "  vec2 c = vec2(-0.8 + 0.6 * sin(u_time * 0.23), 0.156 + 0.4 * cos(u_time * 0.19));\n"
-      "  float m2 = 0.0;\n"
-      "  float iter = 0.0;\n"
-      "  for (int i = 0; i < 60; i++) {\n"
-      "    z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;\n"
-      "    m2 = dot(z, z);\n"
-      "    iter += 1.0;\n"
-      "    if (m2 > 16.0) break;\n"
-      "  }\n"
-      "  // map iterations to smooth value\n"
-      "  return 1.0 - clamp(iter / 60.0, 0.0, 1.0);\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-else if (element.structure == "reactionDiffusion") {
-  emmitedOutput.helpers +=
-      "// Faux reaction-diffusion: layered noise with temporal warp\n"
-      "float hash(vec2 p){ return fract(sin(dot(p, vec2(127.1,311.7))) * 43758.5453); }\n"
-      "float noise(vec2 p){ vec2 i=floor(p), f=fract(p);\n"
-      "  float a=hash(i), b=hash(i+vec2(1,0)), c=hash(i+vec2(0,1)), d=hash(i+vec2(1,1));\n"
-      "  vec2 u=f*f*(3.0-2.0*f);\n"
-      "  return mix(mix(a,b,u.x), mix(c,d,u.x), u.y);\n"
-      "}\n"
-      "float fbm(vec2 p){ float s=0.0, a=0.5; for(int i=0;i<5;i++){ s+=a*noise(p); p*=2.02; a*=0.5;} return s; }\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  p *= 3.0;\n"
-      "  float t = u_time * 0.2;\n"
-      "  float u = fbm(p + vec2(t, -t));\n"
-      "  float v = fbm(rot * (p * 1.9) + vec2(-t, t));\n"
-      "  float w = fbm((p + vec2(u, v)) * 1.2);\n"
-      "  float rd = smoothstep(0.35, 0.65, w) - 0.5;\n"
-      "  return rd;\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
+  // footprint culling:
+  //   float val_i = <OUTSIDE>;
+  //   if (dot(uv_i, uv_i) < r*r) val_i = <structure>(uv_i);
+  const double r = entry.footprint;
+  ir.declare(val, ir.symbol(entry.outside));
+  ir.assignIf(ir.call(shaderIR::Fn::Dot, {uvi, uvi}), r * r, val, ir.call(entry, {uvi}));
 }
-else if (element.structure == "branchNoise") {
-  emmitedOutput.helpers +=
-      "// Branch-like field via angular warping + ridged fbm\n"
-      "float n2hash(vec2 p){ return fract(sin(dot(p, vec2(41.3, 289.1))) * 43758.5453); }\n"
-      "float n2(vec2 p){ vec2 i=floor(p), f=fract(p);\n"
-      "  float a=n2hash(i), b=n2hash(i+vec2(1,0)), c=n2hash(i+vec2(0,1)), d=n2hash(i+vec2(1,1));\n"
-      "  vec2 u=f*f*(3.0-2.0*f);\n"
-      "  return mix(mix(a,b,u.x), mix(c,d,u.x), u.y);\n"
-      "}\n"
-      "float ridged(vec2 p){ float s=0.0, a=0.5; for(int i=0;i<5;i++){ s+=a*(1.0-abs(2.0*n2(p)-1.0)); p*=2.03; a*=0.5;} return s; }\n"
-      "float " + functionName + "(vec2 p) {\n"
-      "  float r = length(p) + 1e-3;\n"
-      "  float a = atan(p.y, p.x);\n"
-      "  // create preferred growth directions\n"
-      "  float forks = 5.0;\n"
-      "  float dir = cos(a * forks) * 0.5 + 0.5;\n"
-      "  float bark = ridged(p * vec2(2.0, 4.0) + vec2(0.0, u_time*0.15));\n"
-      "  float veins = ridged(vec2(a * 1.5, r * 3.0));\n"
-      "  float trunk = (0.35 / r) * dir; // stronger near center and branch angles\n"
-      "  return trunk + 0.5 * veins + 0.3 * bark - 0.8;\n"
-      "}\n";
-  emmitedOutput.calls += "float " + val + " = " + functionName + "(" + uvi + ");\n";
-}
-
-
 
-
-  
-  return emmitedOutput;
+inline void emitElementStructure(Program &ir, const ShaderElement &element, int elementIndex) {
+  emitElementStructure(ir, element, elementIndex, registry().id(element.structure));
 }
 
 
@@ -350,28 +335,17 @@ else if (element.structure == "branchNoise") {
 
 // STRUCTURE SIZE AND PLACEMENT 
 // ---- Placement: defines uv_<i> from the global uv by translating to (cx, cy) ----
-inline Emitted emitElementPlacement(const ShaderElement& element, int elementIndex) {
-  Emitted out;
-  double cx = 0.0, cy = 0.0;
+// placement centre, clamped to [-1, 1]; (0, 0) when unset
+inline void placementOf(const ShaderElement &element, double &cx, double &cy) {
+  cx = cy = 0.0;
   if (element.placementCoords.size() >= 2) {
     cx = std::max(-1.0, std::min(1.0, element.placementCoords[0]));
     cy = std::max(-1.0, std::min(1.0, element.placementCoords[1]));
   }
-  const std::string uvi = "uv_" + std::to_string(elementIndex);
-
-  if (cx == 0.0 && cy == 0.0) {
-    out.calls += "vec2 " + uvi + " = uv;\n"; // always declares uv_i
-  } else {
-    out.calls += "// placement for element " + std::to_string(elementIndex) + "\n";
-    out.calls += "vec2 " + uvi + " = uv - vec2("
-              + std::to_string(cx) + ", " + std::to_string(cy) + ");\n";
-  }
-  return out;
 }
 
-inline Emitted emitElementSize(const ShaderElement& element, int elementIndex) {
-  Emitted out;
-
+// size clamped to [0.01, 1.0] (warns), 1.0 when unset
+inline double sizeOf(const ShaderElement &element, int elementIndex) {
   // read requested size; default to 1.0 if unset
   double s = (element.size == 0.0 ? 1.0 : static_cast<double>(element.size));
 
@@ -385,14 +359,34 @@ inline Emitted emitElementSize(const ShaderElement& element, int elementIndex) {
               << " size > 1.0; clamped to 1.0" << std::endl;
     s = 1.0;
   }
+  return s;
+}
+
+inline void emitElementPlacement(Program &ir, const ShaderElement& element, int elementIndex) {
+  double cx, cy;
+  placementOf(element, cx, cy);
+  const Var uvi = Var::elementUV(elementIndex);
+
+  if (cx == 0.0 && cy == 0.0) {
+    ir.declare(uvi, ir.var(Var::uv())); // always declares uv_i
+  } else {
+    char index[16];
+    ir.comment({"placement for element ", shaderIR::formatInt(index, elementIndex)});
+    ir.declare(uvi, ir.sub(ir.var(Var::uv()),
+                           ir.call(shaderIR::Fn::Vec2, {ir.constant(cx), ir.constant(cy)})));
+  }
+}
+
+inline void emitElementSize(Program &ir, const ShaderElement& element, int elementIndex) {
+  const double s = sizeOf(element, elementIndex);
 
   // no-op if full size
-  if (s == 1.0) return out;
+  if (s == 1.0) return;
 
-  const std::string uvi = "uv_" + std::to_string(elementIndex);
-  out.calls += "// size for element " + std::to_string(elementIndex) + "\n";
-  out.calls += uvi + " = " + uvi + " / " + std::to_string(s) + ";\n";
-  return out;
+  const Var uvi = Var::elementUV(elementIndex);
+  char index[16];
+  ir.comment({"size for element ", shaderIR::formatInt(index, elementIndex)});
+  ir.assign(uvi, ir.div(ir.var(uvi), ir.constant(s)));
 }
 
 
@@ -400,4 +394,4 @@ inline Emitted emitElementSize(const ShaderElement& element, int elementIndex) {
 
 
 
-}
\ No newline at end of file
+}
@@ -1,52 +1,59 @@
 #pragma once
 
 
-#include "../../shaderLib/shaderLibUtility.hpp"
+#include "../../shaderLib/ShaderLibUtility.hpp"
+#include "../../shaderLib/ShaderIR.hpp"
 
  namespace symmetry {
 using ShaderElement = shaderUtility::ShaderElement;
-using Emitted       = shaderUtility::Emitted;
-
-inline Emitted emitElementSymmetry(const ShaderElement &element, int elementIndex){
-  Emitted emmitedOutput;
+using Program       = shaderIR::Program;
+using Var           = shaderIR::Var;
+using shaderIR::Fn;
+
+// symmetry folds the shared uv (so it carries over to later elements)
+struct SymmetryEntry {
+  const char *name;
+  void (*emit)(Program &ir);
+};
+
+// SYMMETRY LIBRARY
+inline const shaderUtility::EmitterRegistry<SymmetryEntry> &registry() {
+  static const shaderUtility::EmitterRegistry<SymmetryEntry> lib = {
+      {"horizontal", [](Program &ir) {
+         ir.comment({"Apply horizontal symmetry to UVs"});
+         ir.assign(Var::uv(0), ir.call(Fn::Abs, {ir.var(Var::uv(0))}));
+       }},
+      {"vertical", [](Program &ir) {
+         ir.comment({"Apply vertical symmetry to UVs"});
+         ir.assign(Var::uv(1), ir.call(Fn::Abs, {ir.var(Var::uv(1))}));
+       }},
+      {"both", [](Program &ir) {
+         ir.comment({"Apply 4-way symmetry to UVs"});
+         ir.assign(Var::uv(), ir.call(Fn::Abs, {ir.var(Var::uv())}));
+       }},
+      {"none", [](Program &ir) {
+         // No symmetry applied
+         ir.comment({"symmetry: none (no-op)"});
+       }},
+  };
+  return lib;
+}
 
+inline void emitElementSymmetry(Program &ir, const ShaderElement &element, int elementIndex, int symmetryId){
 if (shaderUtility::isBlank(element.symmetry)) {
    std::cerr << "ERROR: Element " << elementIndex << " symmetry is empty " << std::endl;
 
   }
-    const bool known =
-        element.symmetry == "horizontal" ||
-        element.symmetry == "vertical"   ||
-        element.symmetry == "both"       ||
-        element.symmetry == "none";
-   if (!known) {
+   if (symmetryId == shaderUtility::EmitterRegistry<SymmetryEntry>::kUnknown) {
       std::cerr << "ERROR: Inputted symmetry " << elementIndex << " name does not match library" << std::endl;
+      return;
   }
-  
-  if (element.symmetry == "horizontal") {
-    emmitedOutput.calls +=
-        "// Apply horizontal symmetry to UVs\n"
-        "uv.x = abs(uv.x);\n";
-  }
-  else if (element.symmetry == "vertical") {
-    emmitedOutput.calls +=
-        "// Apply vertical symmetry to UVs\n"
-        "uv.y = abs(uv.y);\n";
-  }
-  else if (element.symmetry == "both") {
-    emmitedOutput.calls +=
-        "// Apply 4-way symmetry to UVs\n"
-        "uv = abs(uv);\n";
-  }
-  else if (element.symmetry == "none") {
-  // No symmetry applied
-  emmitedOutput.calls += "// symmetry: none (no-op)\n";
-}
 
-  
-  
+  registry()[symmetryId].emit(ir);
+}
 
-  return emmitedOutput;
+inline void emitElementSymmetry(Program &ir, const ShaderElement &element, int elementIndex){
+  emitElementSymmetry(ir, element, elementIndex, registry().id(element.symmetry));
 }
 
- }
\ No newline at end of file
+ }
@@ -1,60 +1,71 @@
 #pragma once
 
 
-#include "../../shaderLib/shaderLibUtility.hpp"
+#include "../../shaderLib/ShaderLibUtility.hpp"
+#include "../../shaderLib/ShaderIR.hpp"
 
  namespace textures {
 using ShaderElement = shaderUtility::ShaderElement;
-using Emitted       = shaderUtility::Emitted;
+using Program       = shaderIR::Program;
+using Var           = shaderIR::Var;
+using shaderIR::Fn;
 
-inline Emitted emitElementTexture (const ShaderElement &element, int elementIndex) {
-  Emitted out;
-  std::string val = "val_" + std::to_string(elementIndex);
+// texture: fbm tone-map (placeholder). one shared helper per shader
+inline const shaderIR::HelperDef fbmTone = {
+    "fbmTone",
+    "// texture: fbm tone-map (placeholder)\n",
+    "(float x){ return 0.5 + 0.5*sin(6.28318*x + 2.0*x); }\n",
+    shaderIR::Type::Float,
+    {5, 1, 0}};
+
+// each texture reshapes the element's val_i in place
+struct TextureEntry {
+  const char *name;
+  void (*emit)(Program &ir, const Var &val);
+  const char *cheaper = nullptr; ///< budget gate fallback (ShaderCost.hpp)
+};
+
+// TEXTURE LIBRARY
+inline const shaderUtility::EmitterRegistry<TextureEntry> &registry() {
+  static const shaderUtility::EmitterRegistry<TextureEntry> lib = {
+      {"abs", [](Program &ir, const Var &val) {
+         ir.comment({"texture: abs"});
+         ir.assign(val, ir.call(Fn::Abs, {ir.var(val)}));
+       }},
+      {"pow2", [](Program &ir, const Var &val) {
+         ir.comment({"texture: power curve (x^2)"});
+         ir.assign(val, ir.mul(ir.var(val), ir.var(val)));
+       }},
+      {"smooth", [](Program &ir, const Var &val) {
+         ir.comment({"texture: smoothstep shaping"});
+         ir.assign(val, ir.call(Fn::Smoothstep, {ir.constant(0.0), ir.constant(1.0), ir.var(val)}));
+       }},
+      {"fbm", [](Program &ir, const Var &val) {
+         ir.assign(val, ir.call(fbmTone, {ir.var(val)}));
+       }, "smooth"},
+      {"none", [](Program &ir, const Var &) {
+         ir.comment({"texture: none (no-op)"});
+       }},
+      // add back in perlin
+  };
+  return lib;
+}
+
+inline void emitElementTexture (Program &ir, const ShaderElement &element, int elementIndex, int textureId) {
 if (shaderUtility::isBlank(element.texture)) {
    std::cerr << "ERROR: Element " << elementIndex << " texture is empty " << std::endl;
 
   }
-  const bool known =
-      element.texture == "abs"    ||
-      element.texture == "pow2"   ||
-      element.texture == "smooth" ||
-      element.texture == "fbm"    ||
-      element.texture == "none";
-  if (!known) {
+  if (textureId == shaderUtility::EmitterRegistry<TextureEntry>::kUnknown) {
     std::cerr << "ERROR: Element " << elementIndex << " texture name not recognized" << std::endl;
-    return out;
-  
-  }
-  if (element.texture == "abs") {
-  out.calls += "// texture: abs\n";
-  out.calls += val + " = abs(" + val + ");\n";
-}
-else if (element.texture == "pow2") {
-  out.calls += "// texture: power curve (x^2)\n";
-  out.calls += val + " = " + val + " * " + val + ";\n";
-}
-else if (element.texture == "smooth") {
-  out.calls += "// texture: smoothstep shaping\n";
-  out.calls += val + " = smoothstep(0.0, 1.0, " + val + ");\n";
-}
-else if (element.texture == "fbm") {
-  std::string fn = "fbmTone_" + std::to_string(elementIndex);
-  out.helpers +=
-    "// texture: fbm tone-map (placeholder)\n"
-    "float " + fn + "(float x){ return 0.5 + 0.5*sin(6.28318*x + 2.0*x); }\n";
-  out.calls += val + " = " + fn + "(" + val + ");\n";
-}
+    return;
 
-else if (element.texture == "none") {
-  out.calls += "// texture: none (no-op)\n";
+  }
+  registry()[textureId].emit(ir, Var::val(elementIndex));
 }
 
-// add back in perlin
-
-  else {
-    std::cerr << "ERROR: Inputted texture " << elementIndex << "name does not match library" << std::endl;
-  }
-  return out;
+inline void emitElementTexture (Program &ir, const ShaderElement &element, int elementIndex) {
+  emitElementTexture(ir, element, elementIndex, registry().id(element.texture));
 }
 
- }
\ No newline at end of file
+ }
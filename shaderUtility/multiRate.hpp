@@ -0,0 +1,123 @@
+#pragma once
+
+#include "al/graphics/al_FBO.hpp"
+#include "al/graphics/al_Graphics.hpp"
+#include "al/graphics/al_Shader.hpp"
+#include "al/graphics/al_Texture.hpp"
+#include "al/graphics/al_VAOMesh.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../shaderLib/ShaderMultiRate.hpp"
+#include "shadedMesh.hpp"
+
+/*
+Runs the slow half of a template split by shaderLib::splitByRate: its layers
+are rendered into float render targets every 1/slowHz seconds, and the mesh
+drawing the fast shader samples them every frame.
+
+  MultiRateLayers slowLayers;  // next to the ShadedSphere
+  // onCreate (needs the GL context):
+  shaderLib::MultiRateShader split = shaderLib::splitByRate(tmpl);
+  sphere.setShaderSources(vertSource, split.fastGlsl);
+  slowLayers.setup(split);
+  slowLayers.attach(sphere);
+  uTime = sphere.uniformFloat("u_time");
+  // onDraw:
+  slowLayers.update(g, time); // re-renders when due
+  sphere.set(uTime, time);
+  sphere.draw(g);
+*/
+
+class MultiRateLayers {
+public:
+  /// compile the slow pass and make its targets. true with nothing to do when
+  /// the split has no slow elements
+  bool setup(const shaderLib::MultiRateShader &split,
+             const shaderLib::MultiRateOptions &options = {}) {
+    mTargets.clear();
+    mSamplers = split.samplers;
+    mDue = true;
+    if (split.slowElements.empty()) return true;
+    if (!mShader.compile(split.slowVertex, split.slowGlsl)) {
+      std::cerr << "MultiRate Error: slow pass failed to compile.\n";
+      mShader.printLog();
+      mSamplers.clear();
+      return false;
+    }
+    mTimeLocation = mShader.getUniformLocation("u_time"); // once, not per render
+    mSize = options.size;
+    mPeriod = options.slowHz > 0.0 ? static_cast<float>(1.0 / options.slowHz) : 0.0f;
+
+    for (size_t k = 0; k < mSamplers.size(); ++k) {
+      auto target = std::make_unique<al::Texture>();
+      target->create2D(mSize, mSize, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+      target->filter(al::Texture::LINEAR);
+      target->wrap(al::Texture::CLAMP_TO_EDGE);
+      mFBO.attachTexture2D(*target, GL_COLOR_ATTACHMENT0 + static_cast<unsigned>(k));
+      mTargets.push_back(std::move(target));
+    }
+
+    // [-1, 1] quad; slowVertex scales it to the sphere's vPos.xy
+    mQuad.reset();
+    mQuad.primitive(al::Mesh::TRIANGLE_STRIP);
+    mQuad.vertex(-1, -1, 0);
+    mQuad.vertex(1, -1, 0);
+    mQuad.vertex(-1, 1, 0);
+    mQuad.vertex(1, 1, 0);
+    mQuad.update();
+    return true;
+  }
+
+  /// hand the targets to the mesh drawing split.fastGlsl
+  void attach(ShadedMesh &mesh) {
+    for (size_t k = 0; k < mTargets.size(); ++k) {
+      mesh.setTexture(mSamplers[k], *mTargets[k]);
+    }
+  }
+
+  /// re-render the slow layers if 1/slowHz has passed since the last time
+  /// (or time went backwards). true if it rendered
+  bool update(al::Graphics &g, float time) {
+    if (mTargets.empty()) return false;
+    if (!mDue && time >= mLast && time - mLast < mPeriod) return false;
+
+    g.pushFramebuffer(mFBO);
+    g.pushViewport(0, 0, mSize, mSize);
+    GLenum buffers[8];
+    const int count = static_cast<int>(std::min<size_t>(mTargets.size(), 8));
+    for (int k = 0; k < count; ++k) buffers[k] = GL_COLOR_ATTACHMENT0 + k;
+    glDrawBuffers(count, buffers);
+    mShader.use();
+    if (mTimeLocation >= 0) glUniform1f(mTimeLocation, time);
+    mQuad.draw();
+    g.popViewport();
+    g.popFramebuffer();
+
+    mLast = time;
+    mDue = false;
+    ++mRenders;
+    return true;
+  }
+
+  /// render on the next update() regardless of the rate
+  void invalidate() { mDue = true; }
+  /// slow passes rendered so far
+  size_t renders() const { return mRenders; }
+
+private:
+  al::ShaderProgram mShader;
+  al::FBO mFBO;
+  std::vector<std::unique_ptr<al::Texture>> mTargets;
+  std::vector<std::string> mSamplers;
+  al::VAOMesh mQuad;
+  int mTimeLocation = -1;
+  int mSize = 0;
+  float mPeriod = 0.0f;
+  float mLast = 0.0f;
+  bool mDue = true;
+  size_t mRenders = 0;
+};
@@ -3,11 +3,62 @@
 #include "al/graphics/al_Graphics.hpp"
 #include "al/graphics/al_Mesh.hpp"
 #include "al/graphics/al_Shader.hpp"
+#include "al/graphics/al_Texture.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
+
+#include "../shaderLib/ShaderLibUtility.hpp"
+
+/**
+ * @brief The one uniform buffer behind the FrameUniforms block
+ * (shaderLib GeneratorOptions::uniformBlock). Every program declaring the
+ * block reads it from kFrameBlockBinding, so all meshes and voices share one
+ * buffer and one upload per changed frame. Needs the GL context; the buffer
+ * lives until the context does.
+ */
+class FrameUniformBuffer {
+public:
+  static FrameUniformBuffer &shared() {
+    static FrameUniformBuffer buffer;
+    return buffer;
+  }
+
+  // one glBufferSubData, skipped when frame equals what the buffer holds
+  void update(const shaderUtility::FrameBlock &frame) {
+    if (mBuffer && std::memcmp(&frame, &mLast, sizeof frame) == 0) {
+      ++mSkipped;
+      return;
+    }
+    if (!mBuffer) {
+      glGenBuffers(1, &mBuffer);
+      glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+      glBufferData(GL_UNIFORM_BUFFER, sizeof frame, &frame, GL_DYNAMIC_DRAW);
+      glBindBufferBase(GL_UNIFORM_BUFFER, shaderUtility::kFrameBlockBinding, mBuffer);
+    } else {
+      glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+      glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof frame, &frame);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    mLast = frame;
+    ++mUploads;
+  }
+
+  size_t uploads() const { return mUploads; }
+  size_t skipped() const { return mSkipped; }
+
+private:
+  GLuint mBuffer = 0;
+  shaderUtility::FrameBlock mLast;
+  size_t mUploads = 0;
+  size_t mSkipped = 0;
+};
 
 /**
  * @brief Mesh with associated ShaderProgram.
@@ -23,7 +74,81 @@ public:
   bool setShaders(const std::string &vertexShaderPath,
                   const std::string &fragmentShaderPath);
 
-  // Uniform setters (will add overloads as needed)
+  // Compile from source strings already in memory (e.g. straight from
+  // shaderLib::generateShaderCode) - no file write/read or path lookup.
+  bool setShaderSources(const std::string &vertexSource,
+                        const std::string &fragmentSource);
+
+  // === Uniform handles === //
+  // setShaderSources reads the program's active uniforms into a table once,
+  // after linking. uniformFloat("u_time") etc. return a typed handle - an index
+  // into this mesh's slots, re-resolved against the table on every recompile,
+  // so a handle made once (e.g. in init) survives shader reloads. set(handle,
+  // value) only writes a CPU-side shadow copy: no strings, no GL calls.
+  // flushUniforms() then binds the program once and uploads just the values
+  // that changed since the program last saw them. A recompile re-sends every
+  // value that was set, so new shaders pick up the current palette / config.
+  // Uniforms the shader doesn't have (or the compiler dropped) are reported
+  // once at link time and never uploaded.
+  template <typename T> struct Uniform {
+    int slot = -1;
+    bool valid() const { return slot >= 0; }
+  };
+  Uniform<float> uniformFloat(const std::string &name, bool warnIfMissing = true);
+  Uniform<int> uniformInt(const std::string &name, bool warnIfMissing = true);
+  Uniform<al::Vec3f> uniformVec3f(const std::string &name, bool warnIfMissing = true);
+  Uniform<al::Mat4f> uniformMat4f(const std::string &name, bool warnIfMissing = true);
+
+  void set(Uniform<float> u, float value);
+  void set(Uniform<int> u, int value);
+  void set(Uniform<al::Vec3f> u, const al::Vec3f &vec);
+  void set(Uniform<al::Mat4f> u, const al::Mat4f &mat);
+
+  // uniform float / vec2 / vec3 / vec4 name[count] - e.g. the arrays a fused
+  // loop reads (shaderLib/ShaderFused.hpp), so elements can move without a
+  // recompile. set() takes count * components floats; a shader whose array
+  // the compiler shortened gets the first elements
+  struct UniformArray {
+    int slot = -1;
+    int floats = 0; ///< count * components
+    bool valid() const { return slot >= 0; }
+  };
+  UniformArray uniformArray(const std::string &name, int components, int count, bool warnIfMissing = true);
+  // handle for a FusedShader::uniforms entry, already set to its values
+  UniformArray uniformArray(const shaderUtility::FusedUniform &u, bool warnIfMissing = true);
+  void set(UniformArray u, const float *values);
+  void set(UniformArray u, const shaderUtility::FusedUniform &values);
+
+  // bind the program and upload changed uniforms (and sampler units) - once per
+  // draw, after the set() calls. ShadedSphere::draw does it
+  void flushUniforms();
+
+  // uploads made / redundant set()s skipped (value equal to the shadow copy)
+  struct UniformStats {
+    size_t uploads = 0;
+    size_t skipped = 0;
+  };
+  const UniformStats &uniformStats() const { return mFrameStats; } ///< last flushUniforms()
+  const UniformStats &uniformTotals() const { return mTotalStats; } ///< since construction
+
+  // the per-frame time / audio values. a program with the FrameUniforms block
+  // gets them through the shared FrameUniformBuffer (one buffer update for all
+  // of them); any other program gets the same names as loose uniforms, so
+  // hand-written .frag files keep working
+  void setFrame(const shaderUtility::FrameBlock &frame);
+  bool hasFrameBlock() const { return mFrameBlockIndex >= 0; }
+
+  // one active uniform of the last linked program (arrays by their base name)
+  struct ActiveUniform {
+    std::string name;
+    int location = -1;
+    unsigned type = 0; ///< GL_FLOAT, GL_FLOAT_VEC3, ...
+    int size = 1;      ///< array length
+  };
+  const std::vector<ActiveUniform> &activeUniforms() const { return mActive; }
+
+  // By-name setters, kept for one-off use. they go through the same table (no
+  // GL query) but still compare strings - per-frame code should hold handles
   void setUniformFloat(const std::string &name, float value);
   void setUniformInt(const std::string &name, int value);
   void setUniformVec3f(const std::string &name, const al::Vec3f &vec);
@@ -32,10 +157,58 @@ public:
   // updating for spherical purposes. not sure if this will work
   void setMatrices(const al::Mat4f &view, const al::Mat4f &proj);
 
-protected:
+  // Float RGBA texture for a sampler2D uniform, e.g. a baked static layer
+  // (shaderLib/ShaderBake.hpp: BakedLayer). Needs the GL context. Calling it
+  // again with the same sampler replaces the texels.
+  void setTexture(const std::string &sampler, int size, const float *rgba);
+  // a texture someone else owns and fills (e.g. a render target, see
+  // multiRate.hpp); it has to outlive the mesh or the next clearTextures()
+  void setTexture(const std::string &sampler, al::Texture &texture);
+  // bind every texture to its sampler - before drawing
+  void bindTextures();
+  // drop them all (switching to a shader with other samplers)
+  void clearTextures() { mTextures.clear(); }
+
   // Helper function to load shader source code
   static std::string loadFile(const std::string &filePath);
+
+protected:
   al::ShaderProgram mShader;
+
+  struct UniformSlot {
+    std::string name;
+    unsigned type = 0; ///< GL type the handle sends; 0 = any int-like (int, bool, sampler)
+    int location = -1;
+    bool warnIfMissing = true;
+    bool hasValue = false; ///< set() was called at least once
+    bool dirty = false;    ///< shadow differs from what the program holds
+    int count = 1;         ///< array length (UniformArray), 1 otherwise
+    int uploadCount = 1;   ///< count, capped at the program's array size
+    std::vector<float> shadow = std::vector<float>(16); ///< last value set; ints kept bitwise
+  };
+  int uniformSlot(const std::string &name, unsigned type, bool warnIfMissing, int count = 1);
+  void stage(int slot, const float *data, int count);
+  void resolve(UniformSlot &slot) const;
+  int locationOf(const std::string &name) const;
+  void readActiveUniforms();
+  bool mLinked = false;
+  std::vector<ActiveUniform> mActive;
+  std::vector<UniformSlot> mSlots;
+  bool mAnyDirty = false;     ///< some slot needs uploading
+  bool mSamplersDirty = false; ///< sampler units not yet sent to this program
+  UniformStats mPendingStats, mFrameStats, mTotalStats;
+  Uniform<al::Mat4f> mModelView, mProjection;
+  int mFrameBlockIndex = -1; ///< FrameUniforms in the linked program, or -1
+  Uniform<float> mFrameLoose[shaderUtility::kFrameBlockMemberCount];
+
+  struct SamplerTexture {
+    std::string sampler;
+    al::Texture *texture = nullptr;
+    std::unique_ptr<al::Texture> owned; ///< set when the texels came from setTexture(.., rgba)
+    int location = -1;                  ///< the sampler's uniform, resolved at link time
+  };
+  SamplerTexture &textureSlot(const std::string &sampler);
+  std::vector<SamplerTexture> mTextures; ///< texture unit = index
 };
 
 // INLINE DEFS BELOW TO KEEP THINGS TIDY AND EFFICIENT. (there might be a better
@@ -56,48 +229,243 @@ inline std::string ShadedMesh::loadFile(const std::string &filePath) {
 // Set vertex and fragment shaders from file paths
 inline bool ShadedMesh::setShaders(const std::string &vertexShaderPath,
                                    const std::string &fragmentShaderPath) {
-  std::string vertexSource = loadFile(vertexShaderPath);
-  std::string fragmentSource = loadFile(fragmentShaderPath);
+  return setShaderSources(loadFile(vertexShaderPath),
+                          loadFile(fragmentShaderPath));
+}
 
+// Set vertex and fragment shaders from source code
+inline bool ShadedMesh::setShaderSources(const std::string &vertexSource,
+                                         const std::string &fragmentSource) {
   if (vertexSource.empty() || fragmentSource.empty()) {
-    std::cerr << "ShaderMesh Error: Shader source file empty.\n";
+    std::cerr << "ShaderMesh Error: Shader source empty.\n";
     return false;
   }
 
   if (!mShader.compile(vertexSource, fragmentSource)) {
     std::cerr << "ShaderMesh Error: Shader failed to compile.\n";
     mShader.printLog();
+    mLinked = false; // handles go quiet until a compile succeeds
+    mFrameBlockIndex = -1;
+    for (UniformSlot &slot : mSlots) slot.location = -1;
     return false;
   }
 
   std::cout << "ShaderMesh: Shaders compiled successfully.\n";
+  readActiveUniforms();
   return true;
 }
 
+// the uniform table, then every handle and sampler re-resolved against it
+inline void ShadedMesh::readActiveUniforms() {
+  mActive.clear();
+  const GLuint program = mShader.id();
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<char> name(static_cast<size_t>(std::max(maxLength, 1)));
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(program, static_cast<GLuint>(i), maxLength, &length, &size, &type, name.data());
+    ActiveUniform u;
+    u.name.assign(name.data(), static_cast<size_t>(length));
+    u.location = glGetUniformLocation(program, u.name.c_str()); // -1 inside uniform blocks
+    if (u.name.size() > 3 && u.name.compare(u.name.size() - 3, 3, "[0]") == 0) {
+      u.name.resize(u.name.size() - 3);
+    }
+    u.type = type;
+    u.size = size;
+    mActive.push_back(std::move(u));
+  }
+  mLinked = true;
+  for (UniformSlot &slot : mSlots) {
+    resolve(slot);
+    slot.dirty = slot.hasValue; // a fresh program holds none of them
+    mAnyDirty = mAnyDirty || slot.dirty;
+  }
+  for (SamplerTexture &t : mTextures) t.location = locationOf(t.sampler);
+  mSamplersDirty = true;
+
+  const GLuint block = glGetUniformBlockIndex(program, shaderUtility::kFrameBlockName);
+  mFrameBlockIndex = (block == GL_INVALID_INDEX) ? -1 : static_cast<int>(block);
+  if (mFrameBlockIndex >= 0) glUniformBlockBinding(program, block, shaderUtility::kFrameBlockBinding);
+}
+
+inline int ShadedMesh::locationOf(const std::string &name) const {
+  for (const ActiveUniform &u : mActive) {
+    if (u.name == name) return u.location;
+  }
+  return -1;
+}
+
+inline void ShadedMesh::resolve(UniformSlot &slot) const {
+  slot.location = -1;
+  if (!mLinked) return;
+  for (const ActiveUniform &u : mActive) {
+    if (u.name != slot.name) continue;
+    const bool floatLike = u.type == GL_FLOAT || u.type == GL_FLOAT_VEC3 || u.type == GL_FLOAT_MAT4 ||
+                           u.type == GL_FLOAT_VEC2 || u.type == GL_FLOAT_VEC4;
+    if (slot.type ? u.type != slot.type : floatLike) {
+      std::cerr << "[Warning] Uniform '" << slot.name << "' has another type in the shader; not set.\n";
+      return;
+    }
+    slot.location = u.location;
+    slot.uploadCount = std::min(slot.count, u.size);
+    return;
+  }
+  if (slot.warnIfMissing) {
+    std::cerr << "[Warning] Uniform '" << slot.name << "' not found in shader.\n";
+  }
+}
+
+inline int ShadedMesh::uniformSlot(const std::string &name, unsigned type, bool warnIfMissing, int count) {
+  for (size_t i = 0; i < mSlots.size(); ++i) {
+    if (mSlots[i].name == name && mSlots[i].type == type && mSlots[i].count == count) return static_cast<int>(i);
+  }
+  mSlots.push_back({name, type, -1, warnIfMissing});
+  UniformSlot &slot = mSlots.back();
+  slot.count = count;
+  if (count > 1) slot.shadow.assign(static_cast<size_t>(count) * 4, 0.0f);
+  resolve(slot);
+  return static_cast<int>(mSlots.size() - 1);
+}
+
+inline ShadedMesh::Uniform<float> ShadedMesh::uniformFloat(const std::string &name, bool warnIfMissing) {
+  return {uniformSlot(name, GL_FLOAT, warnIfMissing)};
+}
+inline ShadedMesh::Uniform<int> ShadedMesh::uniformInt(const std::string &name, bool warnIfMissing) {
+  return {uniformSlot(name, 0, warnIfMissing)};
+}
+inline ShadedMesh::Uniform<al::Vec3f> ShadedMesh::uniformVec3f(const std::string &name, bool warnIfMissing) {
+  return {uniformSlot(name, GL_FLOAT_VEC3, warnIfMissing)};
+}
+inline ShadedMesh::Uniform<al::Mat4f> ShadedMesh::uniformMat4f(const std::string &name, bool warnIfMissing) {
+  return {uniformSlot(name, GL_FLOAT_MAT4, warnIfMissing)};
+}
+inline ShadedMesh::UniformArray ShadedMesh::uniformArray(const std::string &name, int components, int count,
+                                                         bool warnIfMissing) {
+  static const unsigned types[] = {GL_FLOAT, GL_FLOAT_VEC2, GL_FLOAT_VEC3, GL_FLOAT_VEC4};
+  if (components < 1 || components > 4 || count < 1) {
+    std::cerr << "[Warning] Uniform array '" << name << "': " << count << " x " << components
+              << " components not supported.\n";
+    return {};
+  }
+  return {uniformSlot(name, types[components - 1], warnIfMissing, count), components * count};
+}
+inline ShadedMesh::UniformArray ShadedMesh::uniformArray(const shaderUtility::FusedUniform &u,
+                                                         bool warnIfMissing) {
+  const UniformArray handle = uniformArray(u.name, u.components, u.count, warnIfMissing);
+  set(handle, u);
+  return handle;
+}
+
+// the value goes to the shadow copy even when the current shader lacks the
+// uniform, so a later recompile that has it still gets it
+inline void ShadedMesh::stage(int slot, const float *data, int count) {
+  UniformSlot &s = mSlots[slot];
+  const size_t bytes = sizeof(float) * static_cast<size_t>(count);
+  if (s.hasValue && std::memcmp(s.shadow.data(), data, bytes) == 0) {
+    ++mPendingStats.skipped;
+    return;
+  }
+  std::memcpy(s.shadow.data(), data, bytes);
+  s.hasValue = true;
+  s.dirty = true;
+  mAnyDirty = true;
+}
+
+inline void ShadedMesh::set(Uniform<float> u, float value) {
+  if (u.valid()) stage(u.slot, &value, 1);
+}
+inline void ShadedMesh::set(Uniform<int> u, int value) {
+  float bits;
+  std::memcpy(&bits, &value, sizeof bits);
+  if (u.valid()) stage(u.slot, &bits, 1);
+}
+inline void ShadedMesh::set(Uniform<al::Vec3f> u, const al::Vec3f &vec) {
+  const float v[3] = {vec.x, vec.y, vec.z};
+  if (u.valid()) stage(u.slot, v, 3);
+}
+inline void ShadedMesh::set(Uniform<al::Mat4f> u, const al::Mat4f &mat) {
+  if (u.valid()) stage(u.slot, mat.elems(), 16);
+}
+inline void ShadedMesh::set(UniformArray u, const float *values) {
+  if (u.valid()) stage(u.slot, values, u.floats);
+}
+inline void ShadedMesh::set(UniformArray u, const shaderUtility::FusedUniform &values) {
+  if (u.valid() && values.values.size() >= static_cast<size_t>(u.floats)) set(u, values.values.data());
+}
+
+inline void ShadedMesh::setFrame(const shaderUtility::FrameBlock &frame) {
+  if (hasFrameBlock()) {
+    FrameUniformBuffer::shared().update(frame);
+    return;
+  }
+  float values[shaderUtility::kFrameBlockMemberCount];
+  std::memcpy(values, &frame, sizeof values);
+  for (int i = 0; i < shaderUtility::kFrameBlockMemberCount; ++i) {
+    if (!mFrameLoose[i].valid()) {
+      mFrameLoose[i] = uniformFloat(shaderUtility::kFrameBlockMembers[i], false);
+    }
+    set(mFrameLoose[i], values[i]);
+  }
+}
+
+// one bind, then only what changed. Sampler units only change on a relink or
+// a new texture, so they ride the same path instead of being sent every frame.
+// (ShadedSphere's M1 note still holds: allolib re-sends the al_ matrices in
+// g.draw regardless, so something dynamic goes out every frame.)
+inline void ShadedMesh::flushUniforms() {
+  mShader.use();
+  if (mAnyDirty) {
+    for (UniformSlot &s : mSlots) {
+      if (!s.dirty) continue;
+      s.dirty = false;
+      if (s.location < 0) continue;
+      int asInt;
+      switch (s.type) {
+      case GL_FLOAT: glUniform1fv(s.location, s.uploadCount, s.shadow.data()); break;
+      case GL_FLOAT_VEC2: glUniform2fv(s.location, s.uploadCount, s.shadow.data()); break;
+      case GL_FLOAT_VEC3: glUniform3fv(s.location, s.uploadCount, s.shadow.data()); break;
+      case GL_FLOAT_VEC4: glUniform4fv(s.location, s.uploadCount, s.shadow.data()); break;
+      case GL_FLOAT_MAT4: glUniformMatrix4fv(s.location, 1, GL_FALSE, s.shadow.data()); break;
+      default:
+        std::memcpy(&asInt, s.shadow.data(), sizeof asInt);
+        glUniform1i(s.location, asInt);
+        break;
+      }
+      ++mPendingStats.uploads;
+    }
+    mAnyDirty = false;
+  }
+  if (mSamplersDirty) {
+    for (size_t i = 0; i < mTextures.size(); ++i) {
+      if (mTextures[i].location < 0) continue;
+      glUniform1i(mTextures[i].location, static_cast<int>(i));
+      ++mPendingStats.uploads;
+    }
+    mSamplersDirty = false;
+  }
+  mFrameStats = mPendingStats;
+  mTotalStats.uploads += mPendingStats.uploads;
+  mTotalStats.skipped += mPendingStats.skipped;
+  mPendingStats = {};
+}
+
 // INLINE FUNCTIONS BELOW FOR SETTING UNIFORMS
 //  Set a single float uniform
 /// @param name The uniform name inside the shader
 /// @param value The float value to send
 inline void ShadedMesh::setUniformFloat(const std::string &name, float value) {
-  mShader.use(); // 🚨 Make sure shader is active
-  int loc = mShader.getUniformLocation(name.c_str());
-  if (loc >= 0) {
-    mShader.uniform(loc, value);
-  } else {
-    static std::unordered_map<std::string, bool> warned;
-    if (warned.find(name) == warned.end()) {
-      std::cerr << "[Warning] Uniform '" << name << "' not found in shader.\n";
-      warned[name] = true;
-    }
-  }
+  set(uniformFloat(name), value);
 }
 
 // Set a single int uniform
 /// @param name The uniform name inside the shader
 /// @param value The int value to send
 inline void ShadedMesh::setUniformInt(const std::string &name, int value) {
-  mShader.use();
-  mShader.uniform(name.c_str(), value);
+  set(uniformInt(name), value);
 }
 
 // Set a vec3 uniform (3 floats: x, y, z)
@@ -105,8 +473,7 @@ inline void ShadedMesh::setUniformInt(const std::string &name, int value) {
 /// @param value (x, y, z)
 inline void ShadedMesh::setUniformVec3f(const std::string &name,
                                         const al::Vec3f &vec) {
-  mShader.use();
-  mShader.uniform(name.c_str(), vec);
+  set(uniformVec3f(name), vec);
 }
 
 // Set a mat4 uniform (4x4 matrix)
@@ -114,14 +481,56 @@ inline void ShadedMesh::setUniformVec3f(const std::string &name,
 /// @param value 4x4 matrix
 inline void ShadedMesh::setUniformMat4f(const std::string &name,
                                         const al::Mat4f &mat) {
-  mShader.use();
-  mShader.uniform(name.c_str(), mat);
+  set(uniformMat4f(name), mat);
 }
 
 // updating for spherical purposes, not sure if this will workl:
 inline void ShadedMesh::setMatrices(const al::Mat4f &view,
                                     const al::Mat4f &proj) {
-  mShader.use(); // Important: bind before setting uniforms
-  mShader.uniform("al_ModelViewMatrix", view);
-  mShader.uniform("al_ProjectionMatrix", proj);
-}
\ No newline at end of file
+  if (!mModelView.valid()) { // allolib's own names; not every shader reads them
+    mModelView = uniformMat4f("al_ModelViewMatrix", false);
+    mProjection = uniformMat4f("al_ProjectionMatrix", false);
+  }
+  set(mModelView, view);
+  set(mProjection, proj);
+}
+
+inline ShadedMesh::SamplerTexture &
+ShadedMesh::textureSlot(const std::string &sampler) {
+  for (auto &t : mTextures) {
+    if (t.sampler == sampler) return t;
+  }
+  mTextures.push_back({sampler, nullptr, nullptr, locationOf(sampler)});
+  mSamplersDirty = true;
+  return mTextures.back();
+}
+
+// float texture per sampler: linear filtering, clamped (texels cover exactly
+// the baked range)
+inline void ShadedMesh::setTexture(const std::string &sampler, int size,
+                                   const float *rgba) {
+  SamplerTexture &slot = textureSlot(sampler);
+  if (!slot.owned) slot.owned = std::make_unique<al::Texture>();
+  slot.texture = slot.owned.get();
+  al::Texture &tex = *slot.texture;
+  if (!tex.created() || tex.width() != static_cast<unsigned>(size)) {
+    tex.create2D(size, size, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    tex.filter(al::Texture::LINEAR);
+    tex.wrap(al::Texture::CLAMP_TO_EDGE);
+  }
+  tex.submit(rgba, GL_RGBA, GL_FLOAT);
+}
+
+inline void ShadedMesh::setTexture(const std::string &sampler,
+                                   al::Texture &texture) {
+  SamplerTexture &slot = textureSlot(sampler);
+  slot.owned.reset();
+  slot.texture = &texture;
+}
+
+// the samplers' units are uploaded by flushUniforms
+inline void ShadedMesh::bindTextures() {
+  for (size_t i = 0; i < mTextures.size(); ++i) {
+    mTextures[i].texture->bind(static_cast<int>(i));
+  }
+}
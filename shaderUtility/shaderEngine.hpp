@@ -18,6 +18,9 @@
 class ShaderEngine : public al::PositionedVoice {
 private:
   ShadedSphere shaderSphere;
+  // u_time / onset / cent / flux / rms, sent as one FrameUniforms block (or
+  // as loose uniforms to shaders that don't declare it)
+  shaderUtility::FrameBlock frame;
   SpectralListener specListen;
   DynamicListener dynListen;
 
@@ -120,10 +123,12 @@ public:
     g.shader(shaderSphere.shader());
 
     // set unforms
-    shaderSphere.setUniformFloat("u_time", now);
-    shaderSphere.setUniformFloat("onset", onsetIncrement);
-    shaderSphere.setUniformFloat("cent", centroid);
-    shaderSphere.setUniformFloat("flux", flux);
+    frame.u_time = now;
+    frame.onset = onsetIncrement;
+    frame.cent = centroid;
+    frame.flux = flux;
+    frame.rms = rms;
+    shaderSphere.setFrame(frame);
 
     // draw
     shaderSphere.draw(g);
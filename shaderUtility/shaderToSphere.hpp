@@ -2,6 +2,13 @@
 #include "al/graphics/al_Shapes.hpp"
 #include "shadedMesh.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
 /*
 uses shadedMesh to wrap a shader to a sphere -- EXAMPLE USAGE AT BOTTOM OF THIS
 FILE. ALSO IN sphereShaderExample.cpp
@@ -11,13 +18,59 @@ FILE. ALSO IN sphereShaderExample.cpp
     to prevent Metal driver from freezing uniform updates.
 */
 
+// one built sphere on the GPU, shared by every ShadedSphere asking for the same
+// (radius, bands, skybox). uploaded by the first draw that sees it dirty
+struct SphereGeometry {
+  al::VAOMesh mesh;
+  bool dirty = true; // mesh differs from what's on the GPU
+  size_t uploads = 0;
+  size_t uploadedBytes = 0;
+};
+
 class ShadedSphere : public ShadedMesh {
 private:
-  float radius = 1.0f;
-  int subdivisions = 100; // smoothness of sphere
   float pointSize = 10.0f;
+  std::shared_ptr<SphereGeometry> geometry; // what draw() draws; *this stays empty
+  double lastSubmitMs = 0.0;
+
+  using GeometryKey = std::tuple<float, int, bool>;
+  struct GeometryCache {
+    std::mutex mutex;
+    std::map<GeometryKey, std::weak_ptr<SphereGeometry>> entries;
+  };
+  static GeometryCache &geometryCache() {
+    static GeometryCache cache;
+    return cache;
+  }
 
 public:
+  /// the cached sphere for these parameters, built on first request. entries
+  /// live as long as some sphere holds them (the last one out frees the GPU
+  /// buffers, so that needs the GL context like any VAOMesh)
+  static std::shared_ptr<SphereGeometry> sharedGeometry(float r, int bands, bool isSkybox) {
+    GeometryCache &cache = geometryCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (auto it = cache.entries.begin(); it != cache.entries.end();) { // drop freed spheres
+      it = it->second.expired() ? cache.entries.erase(it) : std::next(it);
+    }
+    std::weak_ptr<SphereGeometry> &entry = cache.entries[GeometryKey{r, bands, isSkybox}];
+    if (auto existing = entry.lock()) return existing;
+    auto built = std::make_shared<SphereGeometry>();
+    addTexSphere(built->mesh, r, bands, isSkybox);
+    entry = built;
+    return built;
+  }
+
+  /// spheres alive in the cache - one per distinct (radius, bands, skybox),
+  /// however many voices draw it
+  static size_t sharedGeometryCount() {
+    GeometryCache &cache = geometryCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    size_t alive = 0;
+    for (auto &entry : cache.entries) alive += entry.second.expired() ? 0 : 1;
+    return alive;
+  }
+
   /// Initialize shaders
   /// @param vertPath Path to vertex shader
   /// @param fragPath Path to fragment shader
@@ -25,8 +78,8 @@ public:
   /// sphere vertices
   /// @param r sphere radius
   /// @param subdiv number of subdivisions
-  int addTexSphere(Mesh &m, double radius, int bands, bool isSkybox) {
-    m.primitive(Mesh::TRIANGLES);
+  static int addTexSphere(al::Mesh &m, double radius, int bands, bool isSkybox) {
+    m.primitive(al::Mesh::TRIANGLES);
 
     double &r = radius;
 
@@ -89,15 +142,30 @@ public:
 
     return m.vertices().size();
   }
+  // bands past this only bloat the mesh (1000 would be ~1M vertices)
+  static constexpr int kMinBands = 3;
+  static constexpr int kMaxBands = 250;
+
+  /// the cached skybox sphere for r and subdiv (clamped to
+  /// [kMinBands, kMaxBands]) - voices asking for the same one share it.
+  /// Calling again with the same parameters keeps the sphere (nothing to
+  /// upload); other parameters swap to that sphere, uploaded by the next draw
+  /// if nobody has yet. No context here (update() seg faults), so draw uploads
   void setSphere(float r, int subdiv = 100) {
-    radius = r;
-    subdivisions = subdiv;
-    this->reset();
-    this->primitive(al::Mesh::TRIANGLE_FAN);
-    addTexSphere(*this, 15, 250, true);
-    // this->update(); // 🔥 Push to GPU // seg faults, move to draw
+    geometry = sharedGeometry(r > 0.0f ? r : 15.0f, std::max(kMinBands, std::min(kMaxBands, subdiv)), true);
   }
 
+  /// draw some other cached sphere, e.g. sharedGeometry(1, 64, false)
+  void setGeometry(std::shared_ptr<SphereGeometry> geo) { geometry = std::move(geo); }
+
+  /// uploads of this sphere's (shared) geometry and their size - 1 after the
+  /// first frame, however many spheres share it
+  size_t geometryUploads() const { return geometry ? geometry->uploads : 0; }
+  size_t geometryUploadedBytes() const { return geometry ? geometry->uploadedBytes : 0; }
+  /// CPU time the last draw() took to upload and submit - not GPU time, so
+  /// no measure of bus traffic; geometryUploads / geometryUploadedBytes are
+  double lastDrawSubmitMs() const { return lastSubmitMs; }
+
   /// Update view/projection matrices - should leave
   void setMatrices(const al::Mat4f &view, const al::Mat4f &proj) {
     ShadedMesh::setMatrices(view, proj);
@@ -105,11 +173,24 @@ public:
 
   /// Draw the sphere
   void draw(al::Graphics &g) {
-    this->update();
-    this->mShader.use();
+    if (!geometry) return; // setSphere first
+    const auto t0 = std::chrono::steady_clock::now();
+    // ~63k vertices with normals, texcoords and ~375k indices: upload once
+    SphereGeometry &geo = *geometry;
+    if (geo.dirty) {
+      geo.mesh.update();
+      geo.dirty = false;
+      ++geo.uploads;
+      geo.uploadedBytes += geo.mesh.vertices().size() * sizeof(al::Vec3f) * 2 + // positions + normals
+                           geo.mesh.texCoord2s().size() * sizeof(al::Vec2f) +
+                           geo.mesh.indices().size() * sizeof(unsigned int);
+    }
+    this->bindTextures(); // baked layers, if any
+    this->flushUniforms(); // binds the program; uploads only changed values
     g.pointSize(pointSize);
     // g.depthTesting(true);
-    g.draw(*this);
+    g.draw(geo.mesh);
     // g.depthTesting(false);
+    lastSubmitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
   }
 };
\ No newline at end of file
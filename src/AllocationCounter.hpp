@@ -0,0 +1,57 @@
+#pragma once
+
+// Counts every heap allocation in the process, for the benchmarks' "zero
+// allocations" checks. Replaces the global operator new / delete (plain,
+// array and over-aligned forms; the nothrow ones forward to these), so include
+// it from exactly one .cpp per program - a benchmark's main file.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long long> gAllocations{0};
+
+namespace allocationCounter {
+
+inline void *allocate(std::size_t bytes) {
+  ++gAllocations;
+  if (void *p = std::malloc(bytes ? bytes : 1)) return p;
+  throw std::bad_alloc();
+}
+
+inline void *allocate(std::size_t bytes, std::align_val_t alignment) {
+  ++gAllocations;
+  const std::size_t align = static_cast<std::size_t>(alignment);
+  const std::size_t rounded = (bytes + align - 1) / align * align; // aligned_alloc wants a multiple
+  if (void *p = std::aligned_alloc(align, rounded ? rounded : align)) return p;
+  throw std::bad_alloc();
+}
+
+} // namespace allocationCounter
+
+// g++ sees malloc inside operator new and free inside operator delete once
+// they're inlined into the standard library, and flags every pairing with
+// -Wmismatched-new-delete. The pairing is exactly what's intended here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t bytes) { return allocationCounter::allocate(bytes); }
+void *operator new[](std::size_t bytes) { return allocationCounter::allocate(bytes); }
+void *operator new(std::size_t bytes, std::align_val_t a) { return allocationCounter::allocate(bytes, a); }
+void *operator new[](std::size_t bytes, std::align_val_t a) { return allocationCounter::allocate(bytes, a); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,269 @@
+// Batch shader generator: streams ShaderTemplate records from JSONL (one
+// template per line, see shaderLib/ShaderLibJson.hpp for the format) and writes
+// one .frag per record. No allolib needed:
+//
+//   c++ -std=c++17 -O2 -pthread src/BatchShaderGen.cpp -o batchShaderGen
+//   ./batchShaderGen library.jsonl out/shaders [threads]
+//   cat library.jsonl | ./batchShaderGen - out/shaders
+//   ./batchShaderGen library.jsonl out/shaders 8 12.0 calibration.json
+//   ./batchShaderGen library.jsonl out/shaders 8 0 - .shaderCache
+//
+// The reader only keeps a bounded queue of raw lines in flight and each worker
+// holds a single template + its GLSL, so memory stays flat no matter how many
+// variants are in the stream. Output files are named after the record's "name"
+// field, or the line number if there isn't one. A name already taken by an
+// earlier record (or one that maps to the same file, "a/b" and "a_b") gets the
+// line number appended; a failed write (full disk, ...) counts as failed and
+// leaves no partial file behind.
+//
+// With a frame budget (ms, optionally with a cost calibration JSON, see
+// shaderLib/ShaderCost.hpp) templates estimated over budget are downgraded to
+// cheaper structures/textures until they fit, or skipped and counted as
+// rejected when they can't.
+//
+// Generation goes through one ShaderCache shared by the workers, so a template
+// repeated in the stream is emitted once. With a cache directory (last
+// argument; "-" skips the calibration before it) the GLSL also survives
+// between runs, and rerunning an unchanged library emits nothing.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "../shaderLib/ShaderCache.hpp"
+#include "../shaderLib/ShaderLibJson.hpp"
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Job {
+  long long lineNumber;
+  std::string line;
+};
+
+// fixed-capacity producer/consumer queue. push blocks while full, pop returns
+// false once the queue is closed and drained
+class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity) : mCapacity(capacity) {}
+
+  void push(Job job) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotFull.wait(lock, [&] { return mJobs.size() < mCapacity; });
+    mJobs.push_back(std::move(job));
+    mNotEmpty.notify_one();
+  }
+
+  bool pop(Job &job) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mNotEmpty.wait(lock, [&] { return !mJobs.empty() || mClosed; });
+    if (mJobs.empty()) return false;
+    job = std::move(mJobs.front());
+    mJobs.pop_front();
+    mNotFull.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mClosed = true;
+    mNotEmpty.notify_all();
+  }
+
+private:
+  size_t mCapacity;
+  std::deque<Job> mJobs;
+  bool mClosed = false;
+  std::mutex mMutex;
+  std::condition_variable mNotEmpty;
+  std::condition_variable mNotFull;
+};
+
+// keep record names from escaping the output directory
+std::string safeFileName(const std::string &name) {
+  std::string out;
+  for (char c : name) {
+    const bool ok = std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+                    c == '-' || c == '.';
+    out += ok ? c : '_';
+  }
+  if (out.empty() || out[0] == '.') out = "_" + out;
+  return out;
+}
+
+std::string lineFileName(long long lineNumber) {
+  std::ostringstream ss;
+  ss << "shader_" << std::setw(6) << std::setfill('0') << lineNumber;
+  return ss.str();
+}
+
+// output names handed out so far, shared by the workers
+class NameSet {
+public:
+  // name, or name_<line> when name is taken. "" when both are
+  std::string claim(const std::string &name, long long lineNumber) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mNames.insert(name).second) return name;
+    const std::string suffixed = name + "_" + std::to_string(lineNumber);
+    if (mNames.insert(suffixed).second) return suffixed;
+    return "";
+  }
+
+private:
+  std::mutex mMutex;
+  std::unordered_set<std::string> mNames;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " <templates.jsonl | -> <outDir> [threads] [budgetMs] [calibration.json | -] [cacheDir]\n";
+    return 1;
+  }
+  const std::string inPath = argv[1];
+  const std::filesystem::path outDir = argv[2];
+  const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  const unsigned threads =
+      (argc >= 4) ? static_cast<unsigned>(std::max(1, std::atoi(argv[3]))) : hw;
+
+  shaderLib::GeneratorOptions options;
+  if (argc >= 5) options.budgetMs = std::atof(argv[4]);
+  if (argc >= 6 && std::string(argv[5]) != "-") {
+    std::ifstream calFile(argv[5]);
+    if (!calFile.is_open()) {
+      std::cerr << "Failed to open file: " << argv[5] << std::endl;
+      return 1;
+    }
+    try {
+      options.calibration = json::parse(calFile).get<shaderLib::CostCalibration>();
+    } catch (const std::exception &e) {
+      std::cerr << "ERROR: calibration " << argv[5] << ": " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  std::ifstream file;
+  if (inPath != "-") {
+    file.open(inPath);
+    if (!file.is_open()) {
+      std::cerr << "Failed to open file: " << inPath << std::endl;
+      return 1;
+    }
+  }
+  std::istream &in = (inPath == "-") ? std::cin : file;
+
+  std::error_code ec;
+  std::filesystem::create_directories(outDir, ec);
+  if (ec) {
+    std::cerr << "Failed to create output dir: " << outDir << " (" << ec.message()
+              << ")" << std::endl;
+    return 1;
+  }
+
+  shaderLib::ShaderCache cache(1024, argc >= 7 ? argv[6] : "", options);
+  BoundedQueue queue(threads * 4);
+  std::atomic<long long> written{0};
+  std::atomic<long long> failed{0};
+  std::atomic<long long> rejected{0};
+  std::atomic<long long> bytes{0};
+  NameSet names;
+
+  auto worker = [&] {
+    Job job;
+    while (queue.pop(job)) {
+      try {
+        const json record = json::parse(job.line);
+        const shaderLib::ShaderTemplate tmpl = record.get<shaderLib::ShaderTemplate>();
+        const std::string wanted = record.contains("name")
+                                       ? safeFileName(record["name"].get<std::string>())
+                                       : lineFileName(job.lineNumber);
+        const std::string name = names.claim(wanted, job.lineNumber);
+        if (name.empty()) {
+          std::cerr << "ERROR: line " << job.lineNumber << ": output name " << wanted
+                    << " already taken" << std::endl;
+          ++failed;
+          continue;
+        }
+        if (name != wanted) {
+          std::cerr << "WARNING: line " << job.lineNumber << ": output name " << wanted
+                    << " already taken, writing " << name << ".frag" << std::endl;
+        }
+
+        const std::string code = cache.generate(tmpl);
+        if (code.empty()) { // over budget with nothing left to downgrade
+          ++rejected;
+          continue;
+        }
+        const std::filesystem::path path = outDir / (name + ".frag");
+        std::ofstream out(path);
+        if (!out.is_open()) {
+          std::cerr << "Failed to open file: " << path << std::endl;
+          ++failed;
+          continue;
+        }
+        out << code;
+        out.close();
+        if (out.fail()) {
+          std::cerr << "ERROR: line " << job.lineNumber << ": failed writing " << path << std::endl;
+          std::error_code removeError;
+          std::filesystem::remove(path, removeError);
+          ++failed;
+          continue;
+        }
+        bytes += static_cast<long long>(code.size());
+        ++written;
+      } catch (const std::exception &e) {
+        std::cerr << "ERROR: line " << job.lineNumber << ": " << e.what() << std::endl;
+        ++failed;
+      }
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < threads; ++i) pool.emplace_back(worker);
+
+  std::string line;
+  long long lineNumber = 0;
+  while (std::getline(in, line)) {
+    ++lineNumber;
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+    queue.push(Job{lineNumber, std::move(line)});
+    line.clear();
+  }
+  queue.close();
+  for (auto &t : pool) t.join();
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const shaderLib::ShaderCache::Stats cacheStats = cache.stats();
+  std::cout << "Shaders written to: " << outDir.string() << "\n"
+            << "  written:       " << written << "\n"
+            << "  failed:        " << failed << "\n"
+            << "  rejected:      " << rejected << "\n"
+            << "  bytes:         " << bytes << "\n"
+            << "  cache hits:    " << cacheStats.memoryHits << " memory, " << cacheStats.diskHits
+            << " disk, " << cacheStats.misses << " generated\n"
+            << "  threads:       " << threads << "\n"
+            << "  seconds:       " << seconds << "\n"
+            << "  templates/sec: " << (seconds > 0 ? written / seconds : 0.0) << "\n";
+  return failed == 0 ? 0 : 2;
+}
@@ -18,9 +18,12 @@
 #include <iostream>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "../shaderUtility/shaderToSphere.hpp"
-#include "../shaderLib/shaderLibMaster.hpp"
+#include "../shaderLib/ShaderBake.hpp"
+#include "../shaderLib/ShaderCache.hpp"
+#include "../shaderLib/ShaderLibMaster.hpp"
 
 #include "../agent/src/agent.hpp"
 
@@ -30,9 +33,20 @@ public:
   al::FileSelector selector;
   al::SearchPaths searchPaths;
   ShadedSphere shadedSphere;
+  ShadedMesh::Uniform<float> uTime;
 
   std::string vertPath;
-  std::string fragPath;
+  std::string vertSource;
+  // templates to show, compiled straight from memory. 'n' cycles, 'b' toggles
+  // baking: static layers pre-baked as textures (ShaderBake.hpp), or the plain
+  // GLSL from shaderCache - templates seen before (this run or, through the
+  // cache directory, an earlier one) skip the emitters
+  std::vector<shaderLib::ShaderTemplate> templates;
+  std::vector<shaderLib::BakedShader> bakedSources; ///< same order as templates
+  shaderLib::ShaderCache shaderCache{64, "../shader-env/shaderCache"};
+  bool bakeLayers = true;
+  int currentFrag = 0;
+  bool fragChanged = false;
   al::Parameter globalTime{"globalTime", "", 0.0, 0.0, 3000.0};
 
   al::ParameterBool running{"running", "0", true};
@@ -51,19 +65,28 @@ public:
     } else {
       std::cout << "couldnt find vert scene 5 in path" << std::endl;
     }
-    al::FilePath fragPathSource = searchPaths.find("updatedTestShader.frag");
-    if (fragPathSource.valid()) {
-      fragPath = fragPathSource.filepath();
-      std::cout << "Found file at: " << fragPath << std::endl;
-    } else {
-      std::cout << "couldnt find frag scene 5 in path" << std::endl;
+    // vertex shader never changes, read it once
+    vertSource = ShadedMesh::loadFile(vertPath);
+  }
+
+  // shader + its baked layers; needs the GL context
+  void compileFrag() {
+    shadedSphere.clearTextures();
+    if (!bakeLayers) {
+      shadedSphere.setShaderSources(vertSource, shaderCache.generate(templates[currentFrag]));
+      return;
+    }
+    const shaderLib::BakedShader &frag = bakedSources[currentFrag];
+    shadedSphere.setShaderSources(vertSource, frag.glsl);
+    for (const auto &layer : frag.layers) {
+      shadedSphere.setTexture(layer.sampler, layer.size, layer.rgba.data());
     }
   }
 
   void onCreate() override {
+    uTime = shadedSphere.uniformFloat("u_time");
     shadedSphere.setSphere(15.0, 20);
-    shadedSphere.setShaders(vertPath, fragPath);
-    shadedSphere.update();
+    if (!templates.empty()) compileFrag();
   }
 
   void onAnimate(double dt) override {
@@ -77,8 +100,14 @@ public:
 
     g.clear(0.0);
 
+    // recompile on the graphics thread
+    if (fragChanged) {
+      compileFrag();
+      fragChanged = false;
+    }
+
     g.shader(shadedSphere.shader());
-    shadedSphere.setUniformFloat("u_time", globalTime);
+    shadedSphere.set(uTime, globalTime);
     shadedSphere.draw(g);
   };
 
@@ -93,6 +122,16 @@ public:
         running = false;
         std::cout << "stopped running" << std::endl;
       }
+
+      if (k.key() == 'n' && !templates.empty()) {
+        currentFrag = (currentFrag + 1) % static_cast<int>(templates.size());
+        fragChanged = true;
+      }
+      if (k.key() == 'b' && !templates.empty()) {
+        bakeLayers = !bakeLayers;
+        std::cout << (bakeLayers ? "baked layers" : "cached GLSL, no baking") << std::endl;
+        fragChanged = true;
+      }
     }
   }
 };
@@ -196,10 +235,16 @@ template2.elements.push_back(e2);
 template2.elements.push_back(e3);
 
   // ^ CONCLUDES NEW TEMPLATE CREATION. //
-  std::string shaderCode = shaderLib::generateShaderCode(template2);
-  //std::string shaderCode = shaderLib::generateShaderCode(template2);
-  shaderLib::writeShaderFile("../shader-env/shaders/updatedTestShader.frag", shaderCode);
+  shaderLib::BakedShader shader2 = shaderLib::bakeStaticLayers(template2);
+  // optional side output so the generated GLSL can be inspected; the app
+  // compiles from memory either way
+  const bool writeFragFile = false;
+  if (writeFragFile) {
+    shaderLib::writeShaderFile("../shader-env/shaders/updatedTestShader.frag", shader2.glsl);
+  }
   MyApp app;
+  app.templates = {template2, Template1};
+  app.bakedSources = {shader2, shaderLib::bakeStaticLayers(Template1)};
   app.start();
   return 0;
 }
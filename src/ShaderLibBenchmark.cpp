@@ -0,0 +1,304 @@
+// Generator throughput benchmark for shaderLib. No allolib needed, just the
+// header-only generator:
+//
+//   c++ -std=c++17 -O2 src/ShaderLibBenchmark.cpp -o shaderLibBenchmark
+//   ./shaderLibBenchmark [iterations]
+//
+// Builds a fixed set of templates that touch every structure / texture /
+// symmetry / layering / color / behavior name and times generateShaderCode
+// over them. Prints templates/sec and average GLSL bytes per template (what the
+// driver has to chew through) so runs can be compared before and after
+// generator changes. Also prints IR instruction counts before/after the
+// folding + dead code pass, and the cost of a one-element edit on a
+// 10-element template with and without IncrementalShaderGenerator, and the
+// unrolled vs loop-fused (ShaderFused.hpp) form of templates that repeat one
+// element eight times: GLSL bytes, generation time and, when glslangValidator
+// (the Khronos reference compiler) is on PATH, its compile time for both forms.
+// That is the front end only - the driver's compile needs a GL context and
+// isn't measured here.
+//
+// Then two checks; the program exits with status 1 if either fails, so they
+// can gate a build script:
+//   - ShaderCache: a repeated template is a memory hit, a new cache on the same
+//     directory (a restart) gets a disk hit, a .key file holding another
+//     template's canonical string is a miss, and every hit returns the GLSL
+//     generateShaderCode prints
+//   - zero allocations: a warmed-up ShaderGenerator regenerating every template
+//     must not touch the heap. operator new is replaced (AllocationCounter.hpp)
+//     to count
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../shaderLib/ShaderCache.hpp"
+#include "../shaderLib/ShaderFused.hpp"
+#include "../shaderLib/ShaderIncremental.hpp"
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+#include "AllocationCounter.hpp" // every heap allocation in the process goes through here
+
+namespace {
+
+const std::vector<std::string> kStructures = {
+    "waveGrid",     "noiseGrid",   "circleField",    "blob",
+    "superformula", "lissajous",   "lorenzAttractor", "star",
+    "mandalaRadial", "quasicrystal", "voronoi",       "roseCurve",
+    "superellipse", "phyllotaxis", "julia",          "reactionDiffusion",
+    "branchNoise"};
+const std::vector<std::string> kTextures = {"abs", "pow2", "smooth", "fbm",
+                                            "none"};
+const std::vector<std::string> kSymmetries = {"none", "horizontal", "vertical",
+                                              "both"};
+const std::vector<std::string> kLayerings = {"add", "blend", "screen",
+                                             "multiply", "overlay"};
+const std::vector<std::string> kColorUsages = {"primary", "secondary",
+                                               "default"};
+const std::vector<std::string> kBehaviors = {"",        "scaleWith",
+                                             "sineMod", "rotateUV",
+                                             "scrollUV", "threshWith"};
+
+// one template per structure, each with `elementsPerTemplate` elements so the
+// name lookups dominate the way they do for planner output
+std::vector<shaderLib::ShaderTemplate> makeTemplates(int elementsPerTemplate) {
+  std::vector<shaderLib::ShaderTemplate> templates;
+  int n = 0;
+  for (size_t t = 0; t < kStructures.size(); ++t) {
+    shaderLib::ShaderTemplate tmpl;
+    tmpl.hasBackground = true;
+    tmpl.backgroundColor = "(0.02, 0.02, 0.04)";
+    tmpl.colorPalette = {{0.95f, 0.85f, 0.20f},
+                         {0.10f, 0.55f, 0.95f},
+                         {0.98f, 0.20f, 0.35f}};
+    tmpl.globalUniforms = {"u_time"};
+
+    for (int e = 0; e < elementsPerTemplate; ++e, ++n) {
+      shaderLib::ShaderElement el;
+      el.structure = kStructures[(t + e) % kStructures.size()];
+      el.placementCoords = {0.1 * (e % 5) - 0.2, -0.1 * (e % 3)};
+      el.size = (e % 2) ? 0.5f : 1.0f;
+      el.texture = kTextures[n % kTextures.size()];
+      el.symmetry = kSymmetries[n % kSymmetries.size()];
+      el.layering = kLayerings[n % kLayerings.size()];
+      el.colorUsage = kColorUsages[n % kColorUsages.size()];
+      el.elementBehavior = kBehaviors[n % kBehaviors.size()];
+      el.behaviorUniform = "u_time";
+      el.speed = 0.25 * (1 + n % 4);
+      tmpl.elements.push_back(el);
+    }
+    templates.push_back(tmpl);
+  }
+  return templates;
+}
+
+// per structure: `count` copies of one element at different placements,
+// sizes, speeds and colours - what loop fusion is for
+std::vector<shaderLib::ShaderTemplate> makeRepeatedTemplates(int count) {
+  std::vector<shaderLib::ShaderTemplate> templates = makeTemplates(1);
+  for (shaderLib::ShaderTemplate &tmpl : templates) {
+    const shaderLib::ShaderElement base = tmpl.elements[0];
+    tmpl.elements.clear();
+    for (int e = 0; e < count; ++e) {
+      shaderLib::ShaderElement el = base;
+      el.placementCoords = {-0.7 + 0.2 * e, 0.1 * (e % 3)};
+      el.size = (e % 2) ? 0.5f : 1.0f;
+      el.colorUsage = kColorUsages[e % kColorUsages.size()];
+      el.speed = 0.25 * (1 + e % 4);
+      tmpl.elements.push_back(el);
+    }
+  }
+  return templates;
+}
+
+// glslangValidator's time per shader in ms, its process start-up (a minimal
+// shader) taken off. -1 when it isn't on PATH or rejects a shader
+double frontEndCompileMs(const std::vector<std::string> &shaders, int repeats) {
+  if (std::system("glslangValidator --version > /dev/null 2>&1") != 0) return -1.0;
+  const std::filesystem::path dir = std::filesystem::temp_directory_path();
+  auto timeCompiles = [&](const std::string &glsl, int index) -> double {
+    const std::filesystem::path path = dir / ("shaderLibBenchmark" + std::to_string(index) + ".frag");
+    std::ofstream(path, std::ios::binary) << glsl;
+    const std::string command = "glslangValidator \"" + path.string() + "\" > /dev/null 2>&1";
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+      if (std::system(command.c_str()) != 0) {
+        std::cerr << "ERROR: glslangValidator rejected " << path << std::endl;
+        return -1.0;
+      }
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return ms / repeats;
+  };
+  const double startup = timeCompiles("#version 330 core\nout vec4 fragColor;\nvoid main() { fragColor = vec4(0.0); }\n", 0);
+  if (startup < 0.0) return -1.0;
+  double total = 0.0;
+  for (size_t i = 0; i < shaders.size(); ++i) {
+    const double ms = timeCompiles(shaders[i], static_cast<int>(i) + 1);
+    if (ms < 0.0) return -1.0;
+    total += std::max(0.0, ms - startup);
+  }
+  return total / double(shaders.size());
+}
+
+// memory hit, disk hit after a restart, stale .key rejected. false on failure
+bool checkShaderCache(const std::vector<shaderLib::ShaderTemplate> &templates) {
+  const std::filesystem::path dir = std::filesystem::temp_directory_path() / "shaderLibBenchmarkCache";
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+  const shaderLib::ShaderTemplate &tmpl = templates[0], &other = templates[1];
+  const std::string expected = shaderLib::generateShaderCode(tmpl);
+  bool ok = true;
+  auto check = [&](bool pass, const char *what) {
+    if (!pass) std::cout << "  <-- FAIL: ShaderCache " << what << "\n";
+    ok = ok && pass;
+  };
+  {
+    shaderLib::ShaderCache cache(8, dir.string());
+    check(cache.generate(tmpl) == expected, "miss returned other GLSL");
+    check(cache.generate(tmpl) == expected, "memory hit returned other GLSL");
+    const auto stats = cache.stats();
+    check(stats.misses == 1 && stats.memoryHits == 1, "repeated template was not a memory hit");
+  }
+  {
+    shaderLib::ShaderCache restarted(8, dir.string());
+    check(restarted.generate(tmpl) == expected, "disk hit returned other GLSL");
+    check(restarted.stats().diskHits == 1, "restart was not a disk hit");
+  }
+  {
+    // what a hash collision or an old file looks like: same name, other key
+    const std::string hex = shaderLib::hashToHex(shaderLib::hashTemplate(tmpl));
+    std::ofstream(dir / (hex + ".key"), std::ios::binary) << shaderLib::canonicalTemplate(other);
+    shaderLib::ShaderCache stale(8, dir.string());
+    check(stale.generate(tmpl) == expected, "stale file returned other GLSL");
+    const auto stats = stale.stats();
+    check(stats.diskHits == 0 && stats.misses == 1 && stats.mismatches == 1, "stale .key was not a miss");
+  }
+  std::filesystem::remove_all(dir, ec);
+  std::cout << "ShaderCache: memory hit, disk hit, stale file " << (ok ? "ok" : "FAILED") << "\n";
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const int iterations = (argc >= 2) ? std::max(1, std::atoi(argv[1])) : 2000;
+  const auto templates = makeTemplates(4);
+
+  // warm up (first call pays for any lazily built tables)
+  size_t bytes = 0;
+  shaderIR::InstructionCount before, after;
+  for (const auto &tmpl : templates) {
+    shaderIR::OptimizeStats stats;
+    bytes += shaderLib::generateShaderCode(tmpl, {}, &stats).size();
+    before.statements += stats.before.statements;
+    before.ops += stats.before.ops;
+    after.statements += stats.after.statements;
+    after.ops += stats.after.ops;
+  }
+  const double bytesPerTemplate = double(bytes) / double(templates.size());
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (const auto &tmpl : templates) {
+      bytes += shaderLib::generateShaderCode(tmpl).size();
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  const double count = double(iterations) * double(templates.size());
+  std::cout << "templates:     " << static_cast<long long>(count) << "\n"
+            << "seconds:       " << seconds << "\n"
+            << "templates/sec: " << count / seconds << "\n"
+            << "bytes/template: " << bytesPerTemplate << "\n"
+            << "statements:    " << before.statements << " -> " << after.statements << "\n"
+            << "ops:           " << before.ops << " -> " << after.ops << "\n"
+            << "(checksum " << bytes << " bytes)\n";
+
+  // live-editor case: nudge one element's speed, regenerate
+  shaderLib::ShaderTemplate edited = makeTemplates(10)[0];
+  shaderLib::IncrementalShaderGenerator incremental;
+  bytes += incremental.generate(edited).size();
+  auto timeEdits = [&](auto &&regenerate) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      edited.elements[i % 10].speed += 0.25;
+      bytes += regenerate(edited);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  };
+  const double full = timeEdits([](const shaderLib::ShaderTemplate &t) {
+    return shaderLib::generateShaderCode(t).size();
+  });
+  const double incr = timeEdits([&](const shaderLib::ShaderTemplate &t) {
+    return incremental.generate(t).size();
+  });
+  std::cout << "1-element edit (10 elements): full " << 1e6 * full / iterations
+            << " us, incremental " << 1e6 * incr / iterations << " us\n";
+
+  // unrolled vs looped
+  const auto repeated = makeRepeatedTemplates(8);
+  size_t unrolledBytes = 0, loopedBytes = 0;
+  for (const auto &tmpl : repeated) {
+    unrolledBytes += shaderLib::generateShaderCode(tmpl).size();
+    loopedBytes += shaderLib::generateFusedShaderCode(tmpl).glsl.size();
+  }
+  auto timeRepeated = [&](auto &&generate) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (const auto &tmpl : repeated) bytes += generate(tmpl);
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return 1e6 * s / (double(iterations) * double(repeated.size()));
+  };
+  const double unrolledUs = timeRepeated([](const shaderLib::ShaderTemplate &t) {
+    return shaderLib::generateShaderCode(t).size();
+  });
+  const double loopedUs = timeRepeated([](const shaderLib::ShaderTemplate &t) {
+    return shaderLib::generateFusedShaderCode(t).glsl.size();
+  });
+  std::cout << "8 repeated elements: unrolled " << unrolledBytes / repeated.size() << " bytes, "
+            << unrolledUs << " us; looped " << loopedBytes / repeated.size() << " bytes, "
+            << loopedUs << " us\n";
+  {
+    std::vector<std::string> unrolled, looped;
+    for (const auto &tmpl : repeated) {
+      unrolled.push_back(shaderLib::generateShaderCode(tmpl));
+      looped.push_back(shaderLib::generateFusedShaderCode(tmpl).glsl);
+    }
+    const double unrolledMs = frontEndCompileMs(unrolled, 5);
+    const double loopedMs = unrolledMs < 0.0 ? -1.0 : frontEndCompileMs(looped, 5);
+    if (unrolledMs < 0.0 || loopedMs < 0.0) {
+      std::cout << "  compile time: not measured (needs glslangValidator on PATH)\n";
+    } else {
+      std::cout << "  glslangValidator compile: unrolled " << unrolledMs << " ms, looped " << loopedMs << " ms\n";
+    }
+  }
+
+  const bool cacheOk = checkShaderCache(templates);
+
+  // reused generator: time it, then count allocations over a steady-state pass
+  shaderLib::ShaderGenerator generator;
+  for (const auto &tmpl : templates) bytes += generator.generate(tmpl).size();
+  const auto g0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (const auto &tmpl : templates) bytes += generator.generate(tmpl).size();
+  }
+  const double reusedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g0).count();
+  const long long allocationsBefore = gAllocations.load();
+  for (const auto &tmpl : templates) bytes += generator.generate(tmpl).size();
+  const long long allocations = gAllocations.load() - allocationsBefore;
+  std::cout << "ShaderGenerator: " << count / reusedSeconds << " templates/sec, "
+            << allocations << " allocations over " << templates.size() << " templates"
+            << (allocations ? "  <-- FAIL: steady state should not allocate" : "") << "\n"
+            << "(checksum " << bytes << " bytes)\n";
+  return allocations == 0 && cacheOk ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+// Randomised generator benchmark for shaderLib. No allolib needed:
+//
+//   c++ -std=c++17 -O2 src/ShaderLibFuzzBenchmark.cpp -o shaderLibFuzzBenchmark
+//   ./shaderLibFuzzBenchmark [templatesPerSize] [seed] [--json out.json] [--baseline base.json]
+//
+// Draws random valid templates (shaderLib/ShaderFuzz.hpp - every structure,
+// texture, symmetry, layering, colour and behavior name the emitters accept)
+// at 1, 8 and 64 elements, and times every template on its own through
+// generateShaderCode and through a reused ShaderGenerator. Per size it prints
+// latency percentiles, output bytes and heap allocations per template (counted
+// by AllocationCounter.hpp), and checks that the fuzzer's templates generate
+// without errors and cover every registry name.
+//
+// --json writes the results; --baseline compares against an earlier --json
+// run and exits with status 1 when p50 latency got more than 50% slower or
+// allocations / bytes per template went up. Same seed, same templates, so
+// bytes and allocations compare exactly; latency needs the same machine.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../agent/third_party/nlohmann/json.hpp"
+#include "../shaderLib/ShaderFuzz.hpp"
+#include "../shaderLib/ShaderLibMaster.hpp"
+
+#include "AllocationCounter.hpp"
+
+static size_t gChecksum = 0; // keeps the warm-up pass from being optimised away
+
+namespace {
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  double p50 = 0, p90 = 0, p99 = 0, max = 0; ///< us
+  double bytes = 0;                          ///< per template
+  double allocations = 0;                    ///< per template
+};
+
+double percentile(std::vector<double> sorted, double q) {
+  if (sorted.empty()) return 0.0;
+  std::sort(sorted.begin(), sorted.end());
+  const size_t i = std::min(sorted.size() - 1, static_cast<size_t>(q * (sorted.size() - 1) + 0.5));
+  return sorted[i];
+}
+
+// generate(tmpl) -> GLSL size. one timed call per template after a warm-up pass
+template <typename Generate>
+Result measure(const std::vector<shaderLib::ShaderTemplate> &templates, Generate &&generate) {
+  size_t sink = 0;
+  for (const auto &tmpl : templates) sink += generate(tmpl);
+
+  Result r;
+  std::vector<double> us;
+  us.reserve(templates.size());
+  long long allocations = 0;
+  size_t bytes = 0;
+  for (const auto &tmpl : templates) {
+    const long long a0 = gAllocations.load();
+    const auto t0 = Clock::now();
+    const size_t n = generate(tmpl);
+    const auto t1 = Clock::now();
+    allocations += gAllocations.load() - a0;
+    bytes += n;
+    us.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+  }
+  r.p50 = percentile(us, 0.50);
+  r.p90 = percentile(us, 0.90);
+  r.p99 = percentile(us, 0.99);
+  r.max = us.empty() ? 0.0 : *std::max_element(us.begin(), us.end());
+  r.bytes = double(bytes) / double(templates.size());
+  r.allocations = double(allocations) / double(templates.size());
+  gChecksum += sink + bytes;
+  return r;
+}
+
+json toJson(const Result &r) {
+  return json{{"p50", r.p50}, {"p90", r.p90}, {"p99", r.p99}, {"max", r.max},
+              {"bytes", r.bytes}, {"allocations", r.allocations}};
+}
+
+void printRow(const char *label, int elements, const Result &r) {
+  std::cout << std::left << std::setw(22) << label << std::right << std::setw(4) << elements
+            << std::fixed << std::setprecision(1) << std::setw(10) << r.p50 << std::setw(10) << r.p90
+            << std::setw(10) << r.p99 << std::setw(10) << r.max << std::setw(11) << r.bytes
+            << std::setw(9) << r.allocations << "\n";
+}
+
+// names of a registry the templates never used
+template <typename Registry, typename Field>
+void missingNames(const Registry &registry, const std::vector<shaderLib::ShaderTemplate> &templates,
+                  Field field, const char *what, std::vector<std::string> &missing) {
+  std::set<std::string> seen;
+  for (const auto &tmpl : templates) {
+    for (const auto &e : tmpl.elements) seen.insert(e.*field);
+  }
+  for (const auto &entry : registry) {
+    if (!seen.count(entry.name)) missing.push_back(std::string(what) + " " + entry.name);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int perSize = 2000;
+  unsigned long long seed = 1;
+  std::string jsonPath, baselinePath;
+  int positional = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--json" && i + 1 < argc) jsonPath = argv[++i];
+    else if (arg == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+    else if (positional++ == 0) perSize = std::max(1, std::atoi(argv[i]));
+    else seed = std::strtoull(argv[i], nullptr, 10);
+  }
+
+  std::cout << "seed " << seed << ", " << perSize << " templates per size\n"
+            << std::left << std::setw(22) << "generator" << std::right << std::setw(4) << "n"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p90 us" << std::setw(10) << "p99 us"
+            << std::setw(10) << "max us" << std::setw(11) << "bytes" << std::setw(9) << "allocs"
+            << "\n";
+
+  json results = json::object();
+  std::vector<std::string> missing;
+  long long errors = 0;
+  for (int elements : {1, 8, 64}) {
+    std::mt19937_64 rng(seed + static_cast<unsigned long long>(elements));
+    shaderLib::FuzzOptions options;
+    options.elements = elements;
+    std::vector<shaderLib::ShaderTemplate> templates;
+    templates.reserve(perSize);
+    for (int i = 0; i < perSize; ++i) templates.push_back(shaderLib::randomTemplate(rng, options));
+
+    // validity: the fuzzer's templates must generate without a word on stderr
+    std::ostringstream captured;
+    std::streambuf *old = std::cerr.rdbuf(captured.rdbuf());
+    for (const auto &tmpl : templates) {
+      if (shaderLib::generateShaderCode(tmpl).empty()) ++errors;
+    }
+    std::cerr.rdbuf(old);
+    if (!captured.str().empty()) {
+      ++errors;
+      std::cerr << "ERROR: fuzzed templates (" << elements << " elements) reported:\n"
+                << captured.str().substr(0, 400) << std::endl;
+    }
+    if (elements == 8) {
+      using E = shaderLib::ShaderElement;
+      missingNames(structures::registry(), templates, &E::structure, "structure", missing);
+      missingNames(textures::registry(), templates, &E::texture, "texture", missing);
+      missingNames(symmetry::registry(), templates, &E::symmetry, "symmetry", missing);
+      missingNames(layering::registry(), templates, &E::layering, "layering", missing);
+      missingNames(color::registry(), templates, &E::colorUsage, "colorUsage", missing);
+      missingNames(behave::registry(), templates, &E::elementBehavior, "behavior", missing);
+    }
+
+    const Result oneShot = measure(templates, [](const shaderLib::ShaderTemplate &t) {
+      return shaderLib::generateShaderCode(t).size();
+    });
+    shaderLib::ShaderGenerator generator;
+    const Result reused = measure(templates, [&](const shaderLib::ShaderTemplate &t) {
+      return generator.generate(t).size();
+    });
+    printRow("generateShaderCode", elements, oneShot);
+    printRow("ShaderGenerator", elements, reused);
+    results[std::to_string(elements)] = json{{"generateShaderCode", toJson(oneShot)},
+                                             {"ShaderGenerator", toJson(reused)}};
+  }
+
+  std::cout << "(checksum " << gChecksum << " bytes)\n";
+  for (const std::string &m : missing) std::cerr << "WARNING: fuzzer never drew " << m << std::endl;
+  int status = errors ? 1 : 0;
+
+  if (!jsonPath.empty()) {
+    std::ofstream out(jsonPath);
+    out << json{{"seed", seed}, {"templatesPerSize", perSize}, {"results", results}}.dump(2) << "\n";
+    if (!out) {
+      std::cerr << "Failed to open file: " << jsonPath << std::endl;
+      status = 1;
+    }
+  }
+
+  if (!baselinePath.empty()) {
+    std::ifstream in(baselinePath);
+    if (!in.is_open()) {
+      std::cerr << "Failed to open file: " << baselinePath << std::endl;
+      return 1;
+    }
+    const json base = json::parse(in, nullptr, false);
+    if (base.is_discarded() || !base.contains("results")) {
+      std::cerr << "ERROR: baseline " << baselinePath << " is not a --json result" << std::endl;
+      return 1;
+    }
+    std::cout << "\nvs baseline " << baselinePath << " (p50 ratio, bytes, allocs)\n";
+    for (auto &[size, generators] : results.items()) {
+      if (!base["results"].contains(size)) continue;
+      for (auto &[name, now] : generators.items()) {
+        const json &was = base["results"][size].value(name, json::object());
+        if (was.empty()) continue;
+        const double ratio = now["p50"].get<double>() / std::max(1e-9, was["p50"].get<double>());
+        const bool slower = ratio > 1.5; // single runs on a busy machine wander ~30%
+        const bool bigger = now["bytes"].get<double>() > was["bytes"].get<double>();
+        const bool allocates = now["allocations"].get<double>() > was["allocations"].get<double>();
+        std::cout << std::left << std::setw(22) << name << std::right << std::setw(4) << size
+                  << std::fixed << std::setprecision(2) << std::setw(8) << ratio << "x"
+                  << (bigger ? "  bytes up" : "") << (allocates ? "  allocations up" : "")
+                  << (slower ? "  SLOWER" : "") << "\n";
+        if (slower || bigger || allocates) status = 1;
+      }
+    }
+  }
+  return status;
+}
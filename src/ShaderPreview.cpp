@@ -0,0 +1,80 @@
+// CPU preview: renders one ShaderTemplate (JSON, see shaderLib/ShaderLibJson.hpp)
+// to a PPM without a GPU, using the reference evaluator in shaderLib/ShaderCPU.hpp.
+//
+//   c++ -std=c++17 -O3 -fno-math-errno -pthread src/ShaderPreview.cpp -o shaderPreview
+//   ./shaderPreview template.json out.ppm [time] [size] [planar|sphere] [quality]
+//
+// "sphere" unwraps the ShadedSphere the apps draw on (equirectangular, width is
+// 2x size). A JSONL file works too - the first record is rendered. Mirror
+// symmetric templates only evaluate the unique half/quadrant (ShaderCPU.hpp,
+// detectSymmetry).
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../shaderLib/ShaderCPU.hpp"
+#include "../shaderLib/ShaderLibJson.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " <template.json> <out.ppm> [time] [size] [planar|sphere] [quality]\n";
+    return 1;
+  }
+  std::ifstream file(argv[1]);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << argv[1] << std::endl;
+    return 1;
+  }
+  shaderLib::ShaderTemplate tmpl;
+  try {
+    std::stringstream text;
+    text << file.rdbuf();
+    json j;
+    try {
+      j = json::parse(text.str());
+    } catch (const json::parse_error &) { // JSONL: first non-empty record
+      std::string line;
+      text.clear();
+      text.seekg(0);
+      while (std::getline(text, line) && line.find_first_not_of(" \t\r") == std::string::npos) {
+      }
+      j = json::parse(line);
+    }
+    tmpl = j.get<shaderLib::ShaderTemplate>();
+  } catch (const std::exception &e) {
+    std::cerr << "ERROR: " << argv[1] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  const float time = argc >= 4 ? static_cast<float>(std::atof(argv[3])) : 0.0f;
+  const int size = argc >= 5 ? std::max(1, std::atoi(argv[4])) : 512;
+  shaderCPU::RenderOptions options;
+  options.height = size;
+  options.width = size;
+  if (argc >= 6 && std::string(argv[5]) == "sphere") {
+    options.projection = shaderCPU::Projection::Equirect;
+    options.width = size * 2;
+  }
+  if (argc >= 7) options.quality = std::atoi(argv[6]);
+
+  shaderCPU::Renderer renderer(tmpl, options);
+  shaderCPU::Image image;
+  renderer.render(time, image); // warm up threads / caches
+  const auto t0 = std::chrono::steady_clock::now();
+  renderer.render(time, image);
+  const auto t1 = std::chrono::steady_clock::now();
+
+  if (!shaderCPU::writePPM(argv[2], image)) return 1;
+  std::cout << image.width << "x" << image.height << " at t=" << time << " in "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms -> " << argv[2]
+            << " (" << 100.0 * renderer.evaluatedPixels() / (double(image.width) * image.height)
+            << "% of pixels evaluated, rest mirrored)" << std::endl;
+  return 0;
+}
@@ -27,6 +27,7 @@ public:
   al::FileSelector selector;
   al::SearchPaths searchPaths;
   ShadedSphere shadedSphere;
+  ShadedMesh::Uniform<float> uTime;
 
   std::string vertPath;
   std::string fragPath;
@@ -58,9 +59,9 @@ public:
   }
 
   void onCreate() override {
+    uTime = shadedSphere.uniformFloat("u_time");
     shadedSphere.setSphere(15.0, 20);
     shadedSphere.setShaders(vertPath, fragPath);
-    shadedSphere.update();
   }
 
   void onAnimate(double dt) override {
@@ -75,7 +76,7 @@ public:
     g.clear(0.0);
 
     g.shader(shadedSphere.shader());
-    shadedSphere.setUniformFloat("u_time", globalTime);
+    shadedSphere.set(uTime, globalTime);
     shadedSphere.draw(g);
   };
 
@@ -0,0 +1,108 @@
+// Template library tool: converts between hand-editable JSONL (one template
+// per line, see shaderLib/ShaderLibJson.hpp) and the mmappable binary library
+// format (shaderLib/ShaderLibrary.hpp). No allolib needed:
+//
+//   c++ -std=c++17 -O2 src/TemplateLibraryTool.cpp -o templateLibrary
+//   ./templateLibrary pack library.jsonl library.shlib
+//   ./templateLibrary unpack library.shlib library.jsonl
+//   ./templateLibrary info library.shlib
+//   ./templateLibrary get library.shlib 123456      (one record as JSON)
+//   ./templateLibrary bench library.shlib [lookups]  (open + random access)
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../shaderLib/ShaderLibrary.hpp"
+
+namespace {
+
+int usage(const char *argv0) {
+  std::cerr << "usage: " << argv0 << " pack <in.jsonl> <out.shlib>\n"
+            << "       " << argv0 << " unpack <in.shlib> <out.jsonl>\n"
+            << "       " << argv0 << " info <library.shlib>\n"
+            << "       " << argv0 << " get <library.shlib> <index>\n"
+            << "       " << argv0 << " bench <library.shlib> [lookups]\n";
+  return 1;
+}
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) return usage(argv[0]);
+  const std::string command = argv[1];
+
+  if (command == "pack" || command == "unpack") {
+    if (argc < 4) return usage(argv[0]);
+    const auto t0 = std::chrono::steady_clock::now();
+    const long long count = (command == "pack") ? shaderLib::importJsonl(argv[2], argv[3])
+                                                : shaderLib::exportJsonl(argv[2], argv[3]);
+    if (count < 0) return 1;
+    std::cout << count << " templates -> " << argv[3] << " (" << msSince(t0) << " ms)\n";
+    return 0;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  shaderLib::TemplateLibrary library;
+  if (!library.open(argv[2])) return 1;
+  const double openMs = msSince(t0);
+
+  if (command == "info") {
+    std::cout << "templates: " << library.size() << "\n"
+              << "opened in: " << openMs << " ms\n";
+    return 0;
+  }
+
+  if (command == "get") {
+    if (argc < 4) return usage(argv[0]);
+    const shaderLib::TemplateView v = library.view(std::strtoull(argv[3], nullptr, 10));
+    if (!v.valid()) return 1;
+    nlohmann::json j = v.expand();
+    if (!v.name().empty()) j["name"] = std::string(v.name());
+    std::cout << j.dump(2) << "\n";
+    return 0;
+  }
+
+  if (command == "bench") {
+    if (library.size() == 0) return 0;
+    const long long lookups = (argc >= 4) ? std::max(1LL, std::atoll(argv[3])) : 100000;
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, library.size() - 1);
+    shaderLib::NamePool pool;
+    shaderLib::CompactTemplate compact;
+    size_t elements = 0;
+
+    auto t1 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < lookups; ++i) {
+      const shaderLib::TemplateView v = library.view(pick(rng));
+      if (v.valid()) elements += v.elementCount(); // corrupt records: ERROR printed, skipped
+    }
+    const double viewMs = msSince(t1);
+    t1 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < lookups; ++i) {
+      const shaderLib::TemplateView v = library.view(pick(rng));
+      if (!v.valid()) continue;
+      v.compact(compact, pool);
+      elements += compact.elementCount;
+    }
+    const double compactMs = msSince(t1);
+    t1 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < lookups; ++i) elements += library.get(pick(rng)).elements.size();
+    const double expandMs = msSince(t1);
+
+    std::cout << "templates:   " << library.size() << "\n"
+              << "open:        " << openMs << " ms\n"
+              << "view:        " << 1e3 * viewMs / lookups << " us/lookup\n"
+              << "compact:     " << 1e3 * compactMs / lookups << " us/lookup\n"
+              << "expand:      " << 1e3 * expandMs / lookups << " us/lookup\n"
+              << "(checksum " << elements << ")\n";
+    return 0;
+  }
+  return usage(argv[0]);
+}